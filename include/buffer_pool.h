@@ -0,0 +1,67 @@
+#ifndef NES__BUFFER_POOL_H
+#define NES__BUFFER_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace nes {
+
+  // Size classed memory resource for the I/O buffers (std::pmr::vector<std::byte>)
+  // The blocks are powers of two from min_block to max_block and are kept in free lists after release,
+  // so the receive buffers of many connections are reused instead of fragmenting the global allocator
+  // Not thread safe, use one pool per thread (thread_local_pool) and release the blocks in the same thread
+  class buffer_pool final : public std::pmr::memory_resource
+  {
+  public:
+    static constexpr std::size_t min_block = 256;
+    static constexpr std::size_t max_block = 4 * 1024 * 1024;
+
+    // Blocks of this size or more can be backed by huge pages (Linux)
+    static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+  private:
+    static constexpr std::size_t class_count = 15;
+
+    // Free blocks by size class
+    std::array<std::vector<void*>, class_count> m_free;
+    std::size_t m_cached { 0 };
+    std::size_t m_max_cached;
+    bool m_huge_pages;
+
+    // Requests bigger than max_block or over aligned
+    std::pmr::memory_resource* m_upstream;
+
+    void* allocate_block(std::size_t);
+    void deallocate_block(void*, std::size_t);
+
+    void* do_allocate(std::size_t, std::size_t) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override;
+    bool do_is_equal(const std::pmr::memory_resource&) const noexcept override;
+
+  public:
+    // Cache at most max_cached bytes of free blocks, the excess is released on deallocation
+    explicit buffer_pool(std::size_t max_cached = 64 * 1024 * 1024, bool huge_pages = false,
+      std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~buffer_pool();
+
+    buffer_pool(const buffer_pool&) = delete;
+    buffer_pool& operator=(const buffer_pool&) = delete;
+
+    // Pool of the calling thread
+    static buffer_pool& thread_local_pool();
+
+    // Bytes kept in the free lists
+    std::size_t cached() const;
+    std::size_t max_cached() const;
+    bool huge_pages() const;
+
+    // Release free blocks until the cached bytes are <= max_cached (after a traffic spike)
+    void trim(std::size_t max_cached = 0);
+  };
+
+}
+
+#endif
+// NES__BUFFER_POOL_H
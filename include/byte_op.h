@@ -31,6 +31,10 @@ namespace nes {
   std::string_view bin_to_strv(std::span<const std::byte>);
   std::string bin_to_str(std::span<const std::byte>);
   std::span<const std::byte> strv_to_bin(std::string_view);
+
+  // Search the pattern in data starting at the position (vectorized first byte scan)
+  // Return the position of the first occurrence, data.size() if not found
+  std::size_t bin_find(std::span<const std::byte>, std::span<const std::byte>, std::size_t = 0);
 }
 
 #endif
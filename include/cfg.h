@@ -14,8 +14,53 @@ namespace nes::cfg {
      // Packet Size
      constexpr auto packet_size = size_t { 8'192 };
 
+     // TLS read ahead buffer, many records read from the socket in one call
+     constexpr auto tls_read_ahead_size = size_t { 64 * 1'024 };
+
+     // TLS engine ciphertext buffers (each direction of the memory BIO pair)
+     constexpr auto tls_engine_buffer_size = size_t { 64 * 1'024 };
+
+     // Queued send backpressure (blocked at high, released at low) and kernel not sent limit
+     constexpr auto send_queue_low_watermark = size_t { 64 * 1'024 };
+     constexpr auto send_queue_high_watermark = size_t { 1'024 * 1'024 };
+     constexpr auto notsent_lowat = size_t { 16 * 1'024 };
+
+     // Zero copy send (when enabled) for the sends of this size or more
+     constexpr auto zerocopy_threshold = size_t { 64 * 1'024 };
+
+     // TLS record maximum plaintext size (sends are coalesced in full records)
+     constexpr auto tls_record_size = size_t { 16'384 };
+
+     // Dynamic TLS records, small (one TCP segment) at the connection start and after idle,
+     // full records after the threshold bytes
+     constexpr auto tls_small_record_size = size_t { 1'400 };
+     constexpr auto tls_dynamic_record_threshold = size_t { 64 * 1'024 };
+     constexpr auto tls_dynamic_record_idle = std::chrono::milliseconds { 1'000 };
+
+     // TLS client sessions kept for resumption (host:port/SNI entries)
+     constexpr auto tls_client_session_cache_size = size_t { 1'024 };
+
+     // TLS server session cache and session ticket keys (rotated, the previous ones still decrypt)
+     constexpr auto tls_server_session_cache_size = size_t { 20'480 };
+     constexpr auto tls_session_timeout = std::chrono::seconds { 7'200 };
+     constexpr auto tls_ticket_key_rotation = std::chrono::seconds { 43'200 };
+     constexpr auto tls_ticket_keys_kept = size_t { 2 };
+
      // Retries
      constexpr auto io_max_retry = size_t { 100 };
+
+     // Send without explicit timeout gives up when no byte is written in this time
+     constexpr auto wait_io_send_max = std::chrono::milliseconds { 15'000 };
+
+     // Implicit TLS handshake (first send/receive) gives up after this time
+     constexpr auto tls_handshake_timeout = std::chrono::milliseconds { 15'000 };
+
+     // TLS server handshake workers and the limit of connections in handshake (accepted not established)
+     constexpr auto tls_handshake_workers = size_t { 4 };
+     constexpr auto tls_handshake_max_in_flight = size_t { 256 };
+
+     // Reactor events dispatched per wait
+     constexpr auto reactor_max_events = size_t { 256 };
   }
 
   namespace so {
@@ -0,0 +1,108 @@
+#ifndef NES_NET__REACTOR_H
+#define NES_NET__REACTOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "socket.h"
+#include "socket_serv.h"
+#include "tls_socket.h"
+#include "tls_socket_serv.h"
+
+// Forward declare so do not need include 'sys/epoll.h'
+struct epoll_event;
+
+namespace nes::net {
+
+  // Readiness events (bit mask)
+  enum class io_event : unsigned { none = 0, readable = 1, writable = 2, closed = 4 };
+
+  constexpr io_event operator|(io_event a, io_event b)
+  {
+    return static_cast<io_event>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+  }
+
+  constexpr io_event operator&(io_event a, io_event b)
+  {
+    return static_cast<io_event>(static_cast<unsigned>(a) & static_cast<unsigned>(b));
+  }
+
+  constexpr bool has_event(io_event events, io_event test)
+  {
+    return (events & test) != io_event::none;
+  }
+
+  // Edge-triggered readiness dispatcher (Linux epoll)
+  // The handlers are called once per readiness change, so they must drain the handle:
+  // socket/tls_socket::receive() already reads until would block and the server registrations
+  // accept() until there is no pending client
+  class reactor final
+  {
+  public:
+    using native_handle_type = int;
+    using handler_type = std::function<void(io_event)>;
+
+  private:
+    // epoll handle
+    int m_epoll_fd;
+
+    // Handlers by native handle (shared so a handler can remove itself while running)
+    std::unordered_map<native_handle_type, std::shared_ptr<handler_type>> m_handlers;
+
+    // Events buffer reused between waits
+    std::vector<epoll_event> m_events;
+
+  public:
+    reactor();
+    ~reactor();
+    reactor(reactor&&) noexcept;
+    reactor& operator=(reactor&&) noexcept;
+
+    // No copy (unique epoll handle)
+    reactor(const reactor&) = delete;
+    reactor& operator=(const reactor&) = delete;
+
+    // Registration (Native handle, Events of interest, Handler)
+    void add(native_handle_type, io_event, handler_type);
+    void modify(native_handle_type, io_event);
+    void remove(native_handle_type);
+
+    // Any object that exposes native_handle() (socket, tls_socket, socket_serv, ...)
+    template <class S>
+    void add(const S& s, io_event events, handler_type handler)
+    {
+      this->add(static_cast<native_handle_type>(s.native_handle()), events, std::move(handler));
+    }
+
+    template <class S>
+    void modify(const S& s, io_event events)
+    {
+      this->modify(static_cast<native_handle_type>(s.native_handle()), events);
+    }
+
+    template <class S>
+    void remove(const S& s)
+    {
+      this->remove(static_cast<native_handle_type>(s.native_handle()));
+    }
+
+    // Listening servers, every new client is delivered to the handler
+    // The server must outlive the registration
+    void add(socket_serv&, std::function<void(socket)>);
+    void add(tls_socket_serv&, std::function<void(tls_socket)>);
+
+    bool contains(native_handle_type) const;
+    std::size_t size() const;
+
+    // Wait for events until time expire (negative waits indefinitely) and dispatch them
+    // Return the number of handlers called
+    std::size_t run_once(std::chrono::milliseconds);
+  };
+
+}
+
+#endif
+// NES_NET__REACTOR_H
@@ -0,0 +1,60 @@
+#ifndef NES__RING_BUFFER_H
+#define NES__RING_BUFFER_H
+
+#include <cstddef>
+#include <span>
+
+namespace nes {
+
+  // Circular byte buffer where the storage is mapped twice back-to-back (Linux memfd)
+  // Any readable or writable region is contiguous in memory, even when it wraps the end,
+  // so the parsers can use a plain span (or bin_to_strv) without compacting or copying
+  class ring_buffer final
+  {
+    // Double mapped storage (2 * capacity of address space)
+    std::byte *m_data { nullptr };
+    std::size_t m_capacity { 0 };
+
+    // Positions, m_read < m_capacity and m_write - m_read == size()
+    std::size_t m_read { 0 };
+    std::size_t m_write { 0 };
+
+  public:
+    // Minimum capacity (rounded up to the page size)
+    explicit ring_buffer(std::size_t);
+    ~ring_buffer();
+    ring_buffer(ring_buffer&&) noexcept;
+    ring_buffer& operator=(ring_buffer&&) noexcept;
+
+    // No copy (unique mapping)
+    ring_buffer(const ring_buffer&) = delete;
+    ring_buffer& operator=(const ring_buffer&) = delete;
+
+    std::size_t capacity() const;
+    std::size_t size() const;
+    bool empty() const;
+    bool full() const;
+
+    // Data to parse, mark the parsed bytes with consume
+    std::span<const std::byte> readable() const;
+    void consume(std::size_t);
+
+    // Free space to produce, mark the produced bytes with commit
+    std::span<std::byte> writable();
+    void commit(std::size_t);
+
+    void clear();
+  };
+
+}
+
+namespace nes::net {
+
+  // Receive the available data in the ring free space, return the number of bytes
+  template <class S>
+  std::size_t receive_into(S&, nes::ring_buffer&);
+
+}
+
+#endif
+// NES__RING_BUFFER_H
@@ -0,0 +1,49 @@
+#ifndef NES_NET__SEND_QUEUE_H
+#define NES_NET__SEND_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "cfg.h"
+#include "shared_buffer.h"
+
+namespace nes::net {
+
+  // Per connection output queue, written as the socket accepts without waiting
+  // The watermarks give the backpressure: blocked when the queue reaches the high mark,
+  // released only after it drains to the low mark (hysteresis, no flapping)
+  class send_queue final
+  {
+    buffer_chain m_queue;
+    std::size_t m_low_watermark;
+    std::size_t m_high_watermark;
+    bool m_blocked { false };
+
+    // Data of zero copy sends, kept until the completion (tag is the socket zerocopy_sent count)
+    std::vector<std::pair<std::uint32_t, buffer_chain>> m_zerocopy_pending;
+
+    void update_blocked();
+
+  public:
+    send_queue(std::size_t low_watermark = cfg::net::send_queue_low_watermark,
+               std::size_t high_watermark = cfg::net::send_queue_high_watermark);
+
+    void set_watermarks(std::size_t low_watermark, std::size_t high_watermark);
+
+    void push(nes::shared_buffer);
+
+    // Queued bytes
+    std::size_t size() const;
+    bool empty() const;
+    bool blocked() const;
+
+    // Write what the socket accepts now (gather send), return the number of bytes written
+    template <class S>
+    std::size_t flush(S&);
+  };
+
+}
+
+#endif
+// NES_NET__SEND_QUEUE_H
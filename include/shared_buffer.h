@@ -0,0 +1,74 @@
+#ifndef NES__SHARED_BUFFER_H
+#define NES__SHARED_BUFFER_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace nes {
+
+  // Immutable slice of a reference counted byte buffer
+  // Copy and slice only share the storage (no byte copy), the storage lives while some slice uses it
+  class shared_buffer final
+  {
+    std::shared_ptr<const std::vector<std::byte>> m_storage;
+    std::span<const std::byte> m_data;
+
+  public:
+    shared_buffer() = default;
+
+    // Take the ownership of the data (no copy)
+    explicit shared_buffer(std::vector<std::byte>);
+
+    // Copy the data in a new storage
+    static shared_buffer copy_of(std::span<const std::byte>);
+
+    std::size_t size() const;
+    bool empty() const;
+    const std::byte* data() const;
+    const std::byte* begin() const;
+    const std::byte* end() const;
+    std::span<const std::byte> bytes() const;
+
+    // Sub slice sharing the storage, len is truncated at the slice end
+    shared_buffer slice(std::size_t offset, std::size_t len = static_cast<std::size_t>(-1)) const;
+
+    // Slices sharing the storage (0 if empty)
+    long use_count() const;
+  };
+
+  // Sequence of slices (rope), to gather parts of many buffers without copy
+  class buffer_chain final
+  {
+    std::vector<shared_buffer> m_slices;
+    std::size_t m_size { 0 };
+
+  public:
+    buffer_chain() = default;
+    buffer_chain(std::initializer_list<shared_buffer>);
+
+    void append(shared_buffer);
+    void append(const buffer_chain&);
+
+    // Total bytes
+    std::size_t size() const;
+    bool empty() const;
+    std::span<const shared_buffer> slices() const;
+
+    // Sub chain sharing the storages
+    buffer_chain slice(std::size_t offset, std::size_t len = static_cast<std::size_t>(-1)) const;
+
+    // Drop bytes from the front (sent or parsed)
+    void consume(std::size_t);
+    void clear();
+
+    // Contiguous copy
+    [[nodiscard]] std::vector<std::byte> flatten() const;
+  };
+
+}
+
+#endif
+// NES__SHARED_BUFFER_H
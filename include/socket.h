@@ -3,13 +3,18 @@
 
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <functional>
+#include <memory_resource>
 #include <span>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <vector>
 #include "cfg.h"
+#include "send_queue.h"
+#include "shared_buffer.h"
 #include "unix_socket.h"
 #include "win_socket.h"
 
@@ -21,6 +26,9 @@ namespace nes::net {
     // SO Native Socket
     S m_sock_so;
 
+    // Output queue of enqueue_send
+    send_queue m_send_queue;
+
   public:
     // Exposition
     using os_socket_type = S;
@@ -50,6 +58,61 @@ namespace nes::net {
     void send(std::string_view);
     [[nodiscard]] std::vector<std::byte> receive();
 
+    // Receive in a buffer allocated in the memory resource (buffer_pool)
+    [[nodiscard]] std::pmr::vector<std::byte> receive(std::pmr::memory_resource*);
+
+    // Reference counted versions, the received data can be sliced and shared without copy
+    [[nodiscard]] nes::shared_buffer receive_shared();
+    void send(const nes::buffer_chain&);
+
+    // Send until all data is written or time expire, return the number of bytes written
+    std::size_t send(std::span<const std::byte>, std::chrono::milliseconds);
+    std::size_t send(std::string_view, std::chrono::milliseconds);
+
+    // Gather send, the buffers are written in sequence without concatenation (header + body + trailer)
+    void send(std::span<const std::span<const std::byte>>);
+    std::size_t send(std::span<const std::span<const std::byte>>, std::chrono::milliseconds);
+
+    // File send from offset without user space copy (sendfile), the length is truncated at the end of the file
+    using native_file_type = S::native_file_type;
+    void send_file(native_file_type, std::uint64_t offset = 0, std::uint64_t length = static_cast<std::uint64_t>(-1));
+    void send_file(const std::filesystem::path&, std::uint64_t offset = 0,
+      std::uint64_t length = static_cast<std::uint64_t>(-1));
+
+    // Send until all the file data is written or time expire, return the number of bytes written
+    std::uint64_t send_file(native_file_type, std::uint64_t, std::uint64_t, std::chrono::milliseconds);
+    std::uint64_t send_file(const std::filesystem::path&, std::uint64_t, std::uint64_t, std::chrono::milliseconds);
+
+    // Receive directly in the buffer until it is full or no more data, return the number of bytes
+    [[nodiscard]] std::size_t receive_into(std::span<std::byte>);
+
+    // Scatter receive, the buffers are filled in sequence (header + payload in its final place)
+    [[nodiscard]] std::size_t receive_into(std::span<const std::span<std::byte>>);
+
+    // Block until there is data to receive/room to send or time expire (true if ready)
+    bool wait_readable(std::chrono::milliseconds);
+    bool wait_writable(std::chrono::milliseconds);
+
+    // Queued send without waiting, the data is written as the socket accepts (flush_send on writable readiness)
+    // Return false while the queue is over the high watermark (backpressure), until it drains to the low one
+    bool enqueue_send(std::span<const std::byte>);
+    bool enqueue_send(nes::shared_buffer);
+    std::size_t flush_send();
+    std::size_t send_queued() const;
+    bool send_blocked() const;
+    void set_send_watermarks(std::size_t low_watermark, std::size_t high_watermark);
+
+    // Limit of not sent bytes in the kernel buffer (TCP_NOTSENT_LOWAT), false if not supported
+    bool set_notsent_lowat(std::size_t = cfg::net::notsent_lowat);
+
+    // Zero copy send for the sends >= threshold (MSG_ZEROCOPY), false if not supported
+    // The send without time (and the queued send) keep the data until the completion,
+    // with the timed send the caller waits wait_zerocopy (or zerocopy_completed) before reuse the data
+    bool enable_zerocopy(std::size_t threshold = cfg::net::zerocopy_threshold);
+    std::uint32_t zerocopy_sent() const;
+    std::uint32_t zerocopy_completed();
+    bool wait_zerocopy(std::chrono::milliseconds);
+
     // I/O basic utilities
     // Where exists the time_expire and/or max_size are used as maximum threasholds
     // Spin receiving data until finds the delim arg, return the data and pos of delim in data
@@ -59,6 +122,7 @@ namespace nes::net {
       std::size_t max_size);
 
     // Read data until receive the exact_size number of bytes
+    // Only the exact_size bytes are read, the data after them is left to the next receive
     template <class R, class P = std::ratio<1>>
     [[nodiscard]] std::vector<std::byte> receive_until_size(std::size_t exact_size,
       std::chrono::duration<R, P> time_expire);
@@ -71,6 +135,22 @@ namespace nes::net {
     // Complete the data arg until the data.size() is equals arg total_size
     template <class R, class P>
     void receive_remaining(std::vector<std::byte>& data, size_t total_size, std::chrono::duration<R, P> time_expire);
+
+    // Caller buffer versions (no allocation), the buffer size is the maximum threshold
+    // Return the bytes filled in the buffer and the pos of delim
+    template <class R, class P = std::ratio<1>>
+    [[nodiscard]] std::pair<std::size_t, std::size_t>
+    receive_until_delimiter(std::span<std::byte> buffer, std::span<const std::byte> delim,
+      std::chrono::duration<R, P> time_expire);
+
+    // Fill all the buffer
+    template <class R, class P = std::ratio<1>>
+    void receive_until_size(std::span<std::byte> buffer, std::chrono::duration<R, P> time_expire);
+
+    // Return the bytes filled in the buffer (>= at_least_size)
+    template <class R, class P = std::ratio<1>>
+    [[nodiscard]] std::size_t receive_at_least(std::span<std::byte> buffer, std::size_t at_least_size,
+      std::chrono::duration<R, P> time_expire);
   };
 
   using socket_so_impl = std::conditional_t<nes::cfg::so::is_windows, nes::so::win_socket
@@ -26,6 +26,10 @@ namespace nes::net {
     bool is_listening() const;
     bool has_client();
 
+    // Native handle
+    using native_handle_type = S::native_handle_type;
+    native_handle_type native_handle() const;
+
     std::optional<socket> accept();
   };
 
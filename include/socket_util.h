@@ -3,6 +3,7 @@
 
 #include <chrono>
 #include <cstddef>
+#include <memory_resource>
 #include <span>
 #include <vector>
 
@@ -12,11 +13,21 @@ namespace nes::net {
   // Where 0 == tries == wait_io_step_min and tries == io_max_retry == wait_io_step_max
   std::chrono::milliseconds calculate_interval_retry(std::size_t);
 
+  // Time left from start until time_expire, rounded up (so never spin on sub-millisecond remainders)
+  template <class R, class P>
+  std::chrono::milliseconds remaining_time(std::chrono::steady_clock::time_point, std::chrono::duration<R, P>);
+
+  // Receive all the available data appended to the buffer (std::vector or std::pmr::vector), grow by packets
+  // With data received an error is left to the next receive, so the data is not lost
+  template <class S, class V>
+  V receive_available(S&, V);
+
   // Input Commom algorithms for normal and secure socket
   template <class S, class R, class P = std::ratio<1>>
   std::pair<std::vector<std::byte>, std::size_t>
   receive_until_delimiter(S&, std::span<const std::byte>, std::chrono::duration<R, P>, std::size_t);
 
+  // Only the size bytes are read, the data after them is left to the next receive
   template <class S, class R, class P = std::ratio<1>>
   std::vector<std::byte> receive_until_size(S&, std::size_t, std::chrono::duration<R, P>);
 
@@ -26,6 +37,34 @@ namespace nes::net {
   template <class S, class R, class P>
   void receive_remaining(S&, std::vector<std::byte>&, size_t, std::chrono::duration<R, P>);
 
+  // Allocator aware versions, the returned buffer is allocated in the memory resource (buffer_pool)
+  template <class S, class R, class P = std::ratio<1>>
+  std::pair<std::pmr::vector<std::byte>, std::size_t>
+  receive_until_delimiter(S&, std::span<const std::byte>, std::chrono::duration<R, P>, std::size_t,
+    std::pmr::memory_resource*);
+
+  template <class S, class R, class P = std::ratio<1>>
+  std::pmr::vector<std::byte> receive_until_size(S&, std::size_t, std::chrono::duration<R, P>,
+    std::pmr::memory_resource*);
+
+  template <class S, class R, class P = std::ratio<1>>
+  std::pmr::vector<std::byte> receive_at_least(S&, std::size_t, std::chrono::duration<R, P>,
+    std::pmr::memory_resource*);
+
+  // Caller buffer versions (no allocation), the buffer size is the maximum threshold
+  // Return the bytes filled in the buffer and the pos of delim
+  template <class S, class R, class P = std::ratio<1>>
+  std::pair<std::size_t, std::size_t>
+  receive_until_delimiter(S&, std::span<std::byte>, std::span<const std::byte>, std::chrono::duration<R, P>);
+
+  // Fill all the buffer
+  template <class S, class R, class P = std::ratio<1>>
+  void receive_until_size(S&, std::span<std::byte>, std::chrono::duration<R, P>);
+
+  // Return the bytes filled in the buffer (>= at least size)
+  template <class S, class R, class P = std::ratio<1>>
+  std::size_t receive_at_least(S&, std::span<std::byte>, std::size_t, std::chrono::duration<R, P>);
+
 }
 
 #endif
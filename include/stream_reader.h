@@ -0,0 +1,61 @@
+#ifndef NES_NET__STREAM_READER_H
+#define NES_NET__STREAM_READER_H
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace nes::net {
+
+  // Buffered reader over a connection (socket or tls_socket)
+  // The bytes received past a delimiter or size boundary stay buffered for the next read,
+  // so pipelined messages are not lost and many messages can come from one receive
+  template <class S>
+  class stream_reader final
+  {
+    // Connection
+    S& m_sock;
+
+    // Received data, [m_begin, m_end) not consumed yet
+    std::vector<std::byte> m_buffer;
+    std::size_t m_begin { 0 };
+    std::size_t m_end { 0 };
+
+    // Receive available data in the buffer tail, return the number of bytes
+    std::size_t fill();
+    std::span<const std::byte> buffered_data() const;
+    void consume(std::size_t);
+
+  public:
+    explicit stream_reader(S&);
+
+    stream_reader(const stream_reader&) = delete;
+    stream_reader& operator=(const stream_reader&) = delete;
+
+    S& stream();
+    std::size_t buffered() const;
+
+    // Buffered data or what is available in the connection, never waits
+    // Return the number of bytes copied in the buffer
+    std::size_t read_some(std::span<std::byte>);
+    [[nodiscard]] std::vector<std::byte> read_some();
+
+    // Read until the delim (included in the return), where max_size is the maximum message size
+    template <class R, class P = std::ratio<1>>
+    [[nodiscard]] std::vector<std::byte> read_until(std::span<const std::byte> delim,
+      std::chrono::duration<R, P> time_expire, std::size_t max_size);
+
+    // Read exactly the number of bytes
+    template <class R, class P = std::ratio<1>>
+    [[nodiscard]] std::vector<std::byte> read_exact(std::size_t exact_size, std::chrono::duration<R, P> time_expire);
+
+    // Fill all the buffer, the data beyond the buffered bytes goes directly to the caller memory
+    template <class R, class P = std::ratio<1>>
+    void read_exact(std::span<std::byte> buffer, std::chrono::duration<R, P> time_expire);
+  };
+
+}
+
+#endif
+// NES_NET__STREAM_READER_H
@@ -0,0 +1,51 @@
+#ifndef NES_NET__TLS_CONTEXT_H
+#define NES_NET__TLS_CONTEXT_H
+
+#include <string>
+
+struct ssl_ctx_st;
+using SSL_CTX = struct ssl_ctx_st;
+
+namespace nes::net {
+
+  // OpenSSL context (SSL_CTX) of the TLS sockets, the copies share the same context (reference counted)
+  // The client and server contexts are configured independently, a server certificate stays in its context
+  // The sockets keep the context alive while connected
+  class tls_context final
+  {
+  public:
+    enum class role { client, server };
+
+  private:
+    SSL_CTX *m_ctx { nullptr };
+    role m_role;
+
+  public:
+    explicit tls_context(role = role::client);
+    ~tls_context();
+
+    tls_context(const tls_context&);
+    tls_context(tls_context&&);
+
+    tls_context& operator=(const tls_context&);
+    tls_context& operator=(tls_context&&);
+
+    role context_role() const;
+
+    // OpenSSL handle, for settings out of this class
+    SSL_CTX* native_handle() const;
+
+    // Server certificate and private key (PEM files)
+    void use_certificate(const std::string& pubkey_path, const std::string& privkey_path);
+
+    // Client context shared by the process (default of tls_socket)
+    static const tls_context& client();
+
+    // Client context of the calling thread, no contention on the context locks with the other threads
+    static const tls_context& thread_client();
+  };
+
+}
+
+#endif
+// NES_NET__TLS_CONTEXT_H
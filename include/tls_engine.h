@@ -0,0 +1,83 @@
+#ifndef NES_NET__TLS_ENGINE_H
+#define NES_NET__TLS_ENGINE_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+#include "cfg.h"
+#include "tls_context.h"
+
+struct ssl_st;
+using SSL = struct ssl_st;
+struct bio_st;
+using BIO = struct bio_st;
+
+namespace nes::net {
+
+  // TLS state machine over memory buffers (BIO pair), without a file descriptor
+  // The transport is of the caller: the ciphertext received goes in by feed() and the ciphertext to send
+  // comes out by take_output(), the plaintext goes in by write() and comes out by read()
+  // After each feed/write (and in the handshake) take the output and send it to the peer
+  class tls_engine final
+  {
+    SSL *m_ssl { nullptr };
+
+    // Caller side of the BIO pair, the other side is of the SSL handle
+    BIO *m_net_bio { nullptr };
+
+    bool m_handshake_done { false };
+    bool m_closed { false };
+
+    // Throw the error of a SSL call (WANT_* and the close are not errors)
+    void check_error(int, const char*);
+
+  public:
+    // Client or server by the context role
+    explicit tls_engine(const tls_context&, std::size_t buffer_size = cfg::net::tls_engine_buffer_size);
+    ~tls_engine();
+
+    tls_engine(const tls_engine&) = delete;
+    tls_engine& operator=(const tls_engine&) = delete;
+
+    tls_engine(tls_engine&&);
+    tls_engine& operator=(tls_engine&&);
+
+    // Client virtual host name (SNI), before the handshake
+    void tls_ext_host_name(const std::string&);
+
+    // Handshake step with the ciphertext fed until now, true when over
+    bool handshake();
+    bool handshake_done() const;
+
+    // Peer close (close_notify received)
+    bool is_closed() const;
+
+    // Ciphertext from the transport, return the bytes accepted (less when the input buffer is full)
+    std::size_t feed(std::span<const std::byte>);
+
+    // Ciphertext to the transport
+    std::size_t output_size() const;
+    std::size_t take_output(std::span<std::byte>);
+    [[nodiscard]] std::vector<std::byte> take_output();
+
+    // Plaintext to encrypt, return the bytes accepted (less when the output buffer is full)
+    std::size_t write(std::span<const std::byte>);
+
+    // Decrypted plaintext, 0 when more ciphertext is needed
+    [[nodiscard]] std::size_t read(std::span<std::byte>);
+
+    // Decrypted bytes ready to read
+    std::size_t pending() const;
+
+    // Send close_notify (in the output)
+    void shutdown();
+
+    std::string cipher() const;
+    std::string tls_protocol() const;
+  };
+
+}
+
+#endif
+// NES_NET__TLS_ENGINE_H
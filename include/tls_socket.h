@@ -2,12 +2,18 @@
 #define NES_NET__TLS_SOCKET_H
 
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <functional>
+#include <memory_resource>
 #include <span>
 #include <string>
 #include <string_view>
 #include <vector>
+#include "send_queue.h"
+#include "shared_buffer.h"
 #include "socket.h"
+#include "tls_context.h"
 
 struct ssl_st;
 using SSL = struct ssl_st;
@@ -20,18 +26,38 @@ namespace nes::net {
     socket m_sock;
     SSL *m_sock_ssl { nullptr };
 
+    // Host as passed to connect (session cache key, not the resolved address)
+    std::string m_host;
+
+    // Output queue of enqueue_send
+    send_queue m_send_queue;
+
     // TLS Handshake state
     enum class handshake_state { connect, accept, ok };
     handshake_state m_handshake { handshake_state::connect };
+
+    // Blocking handshake (steps waiting the socket readiness)
     void handshake();
 
+    // Dynamic record size state, bytes since the start (or idle) and the last write
+    bool m_dynamic_records { true };
+    std::size_t m_record_bytes { 0 };
+    std::chrono::steady_clock::time_point m_last_write {};
+
+    // Size of a write interrupted by WANT_*, the retry can not be smaller
+    std::size_t m_write_retry { 0 };
+
+    // Gather send starting at the byte offset of the buffers, return the number of bytes written
+    std::size_t send_gather(std::span<const std::span<const std::byte>>, std::size_t, std::chrono::milliseconds);
+
   public:
     // Constructor 
     tls_socket();
     tls_socket(SSL*, socket);
 
-    // (Host, port)
+    // (Host, port), in the process client context or in the context arg
     tls_socket(std::string, unsigned);
+    tls_socket(std::string, unsigned, const tls_context&);
 
     ~tls_socket();
 
@@ -43,25 +69,111 @@ namespace nes::net {
 
     // Connection (Host, port)
     void connect(std::string, unsigned);
+    void connect(std::string, unsigned, const tls_context&);
     void disconnect();
 
     // TLS Extensions
     // Virtual host (same host many sites)
     void tls_ext_host_name(std::string);
 
+    // Client session resumption, the sessions are cached by host:port (and SNI name) for the next connects
+    // True when the handshake resumed a cached session (abbreviated handshake)
+    bool session_reused() const;
+    static void clear_session_cache();
+
     // IPv4 Connection Data
     const std::string& ipv4_address() const;
     unsigned ipv4_port() const;
     bool is_connected() const;
 
+    // Native handle (underlying socket)
+    using native_handle_type = socket::native_handle_type;
+    native_handle_type native_handle() const;
+
     std::string cipher() const;
     std::string tls_protocol() const;
 
+    // Kernel TLS (SSL_OP_ENABLE_KTLS), before the handshake, the record crypto goes to the kernel
+    // Without kernel support (TLS ULP) or for the cipher, the connection keeps the OpenSSL path
+    bool enable_ktls();
+    bool ktls_send() const;
+    bool ktls_receive() const;
+
+    // Non-blocking handshake, one step of the TLS negotiation without waiting
+    // While not done wait the socket (native_handle) readability or writability and call again
+    // Without it the handshake is made implicitly (blocking) in the first send/receive
+    enum class handshake_status { want_read, want_write, done };
+    handshake_status handshake_step();
+    bool handshake_done() const;
+
+    // Dynamic record size (default), small records at the start and after idle so the peer decrypts
+    // the first bytes without waiting a full record, then full records for bulk throughput
+    void set_dynamic_records(bool = true);
+
+    // Plaintext size of the next record
+    std::size_t record_size() const;
+
     // I/O basic functions (binary or binary char)
     void send(std::span<const std::byte>);
     void send(std::string_view);
     [[nodiscard]] std::vector<std::byte> receive();
 
+    // Receive in a buffer allocated in the memory resource (buffer_pool)
+    [[nodiscard]] std::pmr::vector<std::byte> receive(std::pmr::memory_resource*);
+
+    // Reference counted versions, the received data can be sliced and shared without copy
+    [[nodiscard]] nes::shared_buffer receive_shared();
+    void send(const nes::buffer_chain&);
+
+    // Send until all data is written or time expire, return the number of bytes written
+    // A record interrupted by the time expire is not counted, send again from the returned position
+    std::size_t send(std::span<const std::byte>, std::chrono::milliseconds);
+    std::size_t send(std::string_view, std::chrono::milliseconds);
+
+    // Gather send, the buffers are written in sequence without concatenation (header + body + trailer)
+    void send(std::span<const std::span<const std::byte>>);
+    std::size_t send(std::span<const std::span<const std::byte>>, std::chrono::milliseconds);
+
+    // File send from offset (SSL_sendfile with kernel TLS, read and send otherwise)
+    // The length is truncated at the end of the file
+    void send_file(const std::filesystem::path&, std::uint64_t offset = 0,
+      std::uint64_t length = static_cast<std::uint64_t>(-1));
+
+    // Send until all the file data is written or time expire, return the number of bytes written
+    std::uint64_t send_file(const std::filesystem::path&, std::uint64_t, std::uint64_t, std::chrono::milliseconds);
+
+    // Receive directly in the buffer until it is full or no more data, return the number of bytes
+    [[nodiscard]] std::size_t receive_into(std::span<std::byte>);
+
+    // Scatter receive, the buffers are filled in sequence (header + payload in its final place)
+    [[nodiscard]] std::size_t receive_into(std::span<const std::span<std::byte>>);
+
+    // Read ahead buffer length (the context default is cfg::net::tls_read_ahead_size), 0 disables
+    // The length applies to the buffer allocated in the handshake, set it before the first I/O
+    void set_read_ahead(std::size_t);
+
+    // Decrypted bytes ready to receive, and if there is any buffered data (also records not decrypted)
+    // The buffered data can be a partial record, it is not ready to receive until the rest arrives
+    std::size_t pending() const;
+    bool has_pending() const;
+
+    // Block until there is data to receive/room to send or time expire (true if ready)
+    // Data decrypted or a whole record buffered in the TLS layer is ready without waiting the socket
+    bool wait_readable(std::chrono::milliseconds);
+    bool wait_writable(std::chrono::milliseconds);
+
+    // Queued send without waiting, the data is written as the socket accepts (flush_send on writable readiness)
+    // Return false while the queue is over the high watermark (backpressure), until it drains to the low one
+    bool enqueue_send(std::span<const std::byte>);
+    bool enqueue_send(nes::shared_buffer);
+    std::size_t flush_send();
+    std::size_t send_queued() const;
+    bool send_blocked() const;
+    void set_send_watermarks(std::size_t low_watermark, std::size_t high_watermark);
+
+    // Limit of not sent bytes in the kernel buffer (TCP_NOTSENT_LOWAT), false if not supported
+    bool set_notsent_lowat(std::size_t = cfg::net::notsent_lowat);
+
     // I/O basic utilities
     // Where exists the time_expire and/or max_size are used as maximum threasholds
     // Spin receiving data until finds the delim arg, return the data and pos of delim in data
@@ -71,6 +183,7 @@ namespace nes::net {
       std::size_t max_size);
 
     // Read data until receive the exact_size number of bytes
+    // Only the exact_size bytes are read, the data after them is left to the next receive
     template <class R, class P = std::ratio<1>>
     [[nodiscard]] std::vector<std::byte> receive_until_size(std::size_t exact_size,
       std::chrono::duration<R, P> time_expire);
@@ -84,6 +197,22 @@ namespace nes::net {
     template <class R, class P>
     void receive_remaining(std::vector<std::byte>& data, size_t total_size, std::chrono::duration<R, P> time_expire);
 
+    // Caller buffer versions (no allocation), the buffer size is the maximum threshold
+    // Return the bytes filled in the buffer and the pos of delim
+    template <class R, class P = std::ratio<1>>
+    [[nodiscard]] std::pair<std::size_t, std::size_t>
+    receive_until_delimiter(std::span<std::byte> buffer, std::span<const std::byte> delim,
+      std::chrono::duration<R, P> time_expire);
+
+    // Fill all the buffer
+    template <class R, class P = std::ratio<1>>
+    void receive_until_size(std::span<std::byte> buffer, std::chrono::duration<R, P> time_expire);
+
+    // Return the bytes filled in the buffer (>= at_least_size)
+    template <class R, class P = std::ratio<1>>
+    [[nodiscard]] std::size_t receive_at_least(std::span<std::byte> buffer, std::size_t at_least_size,
+      std::chrono::duration<R, P> time_expire);
+
     // Make manual TLS handshake (auxiliary function same thread connection)
     friend void same_thread_handshake(tls_socket&, tls_socket&);
   };
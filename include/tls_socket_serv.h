@@ -1,14 +1,29 @@
 #ifndef NES_NET__TLS_SOCKET_SERV_H
 #define NES_NET__TLS_SOCKET_SERV_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include "socket_serv.h"
+#include "tls_context.h"
 #include "tls_socket.h"
+#include "tls_ticket_keys.h"
 
 namespace nes::net {
 
+  // Resumption counters of a server (shared with the accepted sockets)
+  struct tls_session_counters;
+
+  // Handshake threads of a server
+  struct tls_handshake_workers;
+
   class tls_socket_serv final
   {
+    // Server context (certificate and sessions), can be shared by many listeners
+    tls_context m_ctx { tls_context::role::server };
+
     // SO Native Socket Server
     socket_serv m_sock;
 
@@ -16,9 +31,20 @@ namespace nes::net {
     std::string m_pubkey_path;
     std::string m_privkey_path;
 
+    // Kernel TLS in the accepted sockets
+    bool m_ktls { false };
+
+    // Session resumption, the accepted sockets share the keys and counters (they can outlive the server)
+    std::shared_ptr<tls_ticket_keys> m_ticket_keys;
+    std::shared_ptr<tls_session_counters> m_session_counters;
+
+    // Accept mode with the handshake in the workers (accept_established)
+    std::unique_ptr<tls_handshake_workers> m_workers;
+
   public:
     tls_socket_serv();
     tls_socket_serv(unsigned, std::string, std::string);
+    tls_socket_serv(unsigned, std::string, std::string, tls_context);
 
     tls_socket_serv(tls_socket_serv&&);
     tls_socket_serv& operator=(tls_socket_serv&&);
@@ -29,7 +55,11 @@ namespace nes::net {
     ~tls_socket_serv();
 
     // Non-block listening (Ipv4 Port, Public Key Path, Private Key Path)
+    // The certificate is loaded in the listener context, or in the server context arg (then shared)
     void listen(unsigned, std::string, std::string);
+    void listen(unsigned, std::string, std::string, tls_context);
+
+    const tls_context& context() const;
 
     unsigned ipv4_port() const;
 
@@ -39,7 +69,41 @@ namespace nes::net {
     bool is_listening() const;
     bool has_client();
 
+    // Server session cache (session ids) of the listener context, size and session lifetime
+    void set_session_cache(std::size_t size = cfg::net::tls_server_session_cache_size,
+      std::chrono::seconds timeout = cfg::net::tls_session_timeout);
+
+    // Session ticket keys, share the same keys between listeners to resume in any of them
+    const std::shared_ptr<tls_ticket_keys>& ticket_keys() const;
+    void set_ticket_keys(std::shared_ptr<tls_ticket_keys>);
+
+    // Handshakes of the accepted sockets (resumed are hits, full are misses)
+    std::uint64_t session_hits() const;
+    std::uint64_t session_misses() const;
+
+    // Accepted sockets request kernel TLS (tls_socket::enable_ktls)
+    void enable_ktls(bool = true);
+    bool ktls_enabled() const;
+
+    // Native handle (underlying socket server)
+    using native_handle_type = socket_serv::native_handle_type;
+    native_handle_type native_handle() const;
+
     std::optional<tls_socket> accept();
+
+    // Handshake workers, the accepted connections are negotiated in a pool of threads
+    // At most max_in_flight connections are in handshake, the next ones wait in the listening backlog
+    void start_handshake_workers(std::size_t workers = cfg::net::tls_handshake_workers,
+      std::size_t max_in_flight = cfg::net::tls_handshake_max_in_flight);
+    void stop_handshake_workers();
+
+    // Accept the new connections to the workers and return an established one (handshake over)
+    // Wait until time expire for an established connection
+    std::optional<tls_socket> accept_established(std::chrono::milliseconds = std::chrono::milliseconds { 0 });
+
+    // Connections accepted and not established, and the failed or expired handshakes
+    std::size_t handshakes_in_flight() const;
+    std::uint64_t handshakes_failed() const;
   };
 }
 
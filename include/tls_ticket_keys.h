@@ -0,0 +1,61 @@
+#ifndef NES_NET__TLS_TICKET_KEYS_H
+#define NES_NET__TLS_TICKET_KEYS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <span>
+#include "cfg.h"
+
+namespace nes::net {
+
+  // Session ticket keys of the TLS servers, the current one encrypts the new tickets
+  // After the rotation the previous keys only decrypt (the ticket is renewed), until they are dropped
+  // Thread safe, the same keys can be shared by many listeners (tls_socket_serv::set_ticket_keys)
+  class tls_ticket_keys final
+  {
+  public:
+    struct key
+    {
+      std::array<unsigned char, 16> name;
+      std::array<unsigned char, 32> aes_key;
+      std::array<unsigned char, 32> hmac_key;
+    };
+
+  private:
+    mutable std::mutex m_mtx;
+
+    // Current key in front
+    std::deque<key> m_keys;
+    std::chrono::steady_clock::time_point m_rotated;
+    std::chrono::seconds m_rotation;
+    std::size_t m_kept;
+
+    void rotate_locked();
+
+  public:
+    // Rotation interval and number of keys kept (current + previous)
+    explicit tls_ticket_keys(std::chrono::seconds rotation = cfg::net::tls_ticket_key_rotation,
+      std::size_t kept = cfg::net::tls_ticket_keys_kept);
+
+    tls_ticket_keys(const tls_ticket_keys&) = delete;
+    tls_ticket_keys& operator=(const tls_ticket_keys&) = delete;
+
+    // New random current key
+    void rotate();
+    std::size_t size() const;
+
+    // Key to encrypt a new ticket, rotate before if the interval expired
+    key current();
+
+    // Key of the ticket name and if it is the current one (false the ticket must be renewed)
+    std::optional<std::pair<key, bool>> find(std::span<const unsigned char, 16>) const;
+  };
+
+}
+
+#endif
+// NES_NET__TLS_TICKET_KEYS_H
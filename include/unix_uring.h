@@ -0,0 +1,112 @@
+#ifndef NES_SO__UNIX_URING_H
+#define NES_SO__UNIX_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "unix_socket.h"
+
+namespace nes::so {
+
+  // io_uring completion backend for unix_socket
+  // The operations are only queued, one submit() sends the whole batch to the kernel in a single
+  // io_uring_enter and reap() collects the completions. The sockets and buffers must stay alive
+  // until the completion of its operations
+  class unix_uring final
+  {
+  public:
+    enum class operation { send, receive, accept, connect };
+
+    struct completion
+    {
+      // User identification of the operation
+      std::uint64_t user_data;
+      operation op;
+
+      // Bytes transferred or the negative errno
+      int result;
+
+      // New client in accept completions
+      std::optional<unix_socket> accepted;
+    };
+
+  private:
+    // Kernel ring handle and mappings
+    int m_ring_fd;
+    void* m_sq_ptr { nullptr };
+    std::size_t m_sq_size { 0 };
+    void* m_cq_ptr { nullptr };
+    std::size_t m_cq_size { 0 };
+    void* m_sqes { nullptr };
+    std::size_t m_sqes_size { 0 };
+
+    // Submission/Completion ring indexes (inside the mappings)
+    unsigned *m_sq_head { nullptr };
+    unsigned *m_sq_tail { nullptr };
+    unsigned *m_sq_mask { nullptr };
+    unsigned *m_sq_array { nullptr };
+    unsigned m_sq_entries { 0 };
+    unsigned *m_cq_head { nullptr };
+    unsigned *m_cq_tail { nullptr };
+    unsigned *m_cq_mask { nullptr };
+    void* m_cqes { nullptr };
+
+    // Queued but not yet submitted
+    unsigned m_to_submit { 0 };
+
+    // In flight operations data (node based, stable address for the kernel)
+    struct pending_op;
+    std::unordered_map<std::uint64_t, pending_op> m_pending;
+    std::uint64_t m_next_id { 0 };
+
+    // Entry filled in two steps, the op data is allocated and only then the complete entry is published
+    void* next_sqe();
+    pending_op& new_op(operation, std::uint64_t);
+    void publish(void*, std::uint64_t);
+
+    // Cancel the in flight operations and wait their completions (the kernel can write in the op data)
+    void cancel_pending();
+    void discard_completions();
+    void release();
+
+  public:
+    // (Number of submission entries)
+    explicit unix_uring(unsigned = 256);
+    ~unix_uring();
+    unix_uring(unix_uring&&) noexcept;
+    unix_uring& operator=(unix_uring&&) noexcept;
+
+    // No copy (unique ring handle)
+    unix_uring(const unix_uring&) = delete;
+    unix_uring& operator=(const unix_uring&) = delete;
+
+    // Queue operations, return false if the submission queue is full (submit and try again)
+    // One send/receive transfers at most 4 GiB - 1 bytes, the rest of a bigger span is a partial transfer
+    // Client API
+    bool queue_send(const unix_socket&, std::span<const std::byte>, std::uint64_t);
+    bool queue_receive(const unix_socket&, std::span<std::byte>, std::uint64_t);
+    // The socket must not be configured, it is set only in a successful completion (Host, Port)
+    bool queue_connect(unix_socket&, std::string, unsigned, std::uint64_t);
+
+    // Server API
+    bool queue_accept(const unix_socket&, std::uint64_t);
+
+    // Submit all queued operations and wait for at least the min number of completions
+    // Return the number of operations submitted
+    std::size_t submit(std::size_t = 0);
+
+    // Collect the available completions in the vector, return how many were appended
+    std::size_t reap(std::vector<completion>&);
+
+    std::size_t queued() const;
+    std::size_t in_flight() const;
+  };
+
+}
+
+#endif
+// NES_SO__UNIX_URING_H
@@ -1,8 +1,10 @@
 #ifndef NES_SO__WIN_SOCKET_H
 #define NES_SO__WIN_SOCKET_H
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <optional>
 #include <span>
 #include <string>
@@ -24,6 +26,12 @@ namespace nes::so {
     std::string m_ipv4_address { "0.0.0.0" };
     unsigned m_ipv4_port { 0 };
 
+    // Poll the handle for the events (POLLRDNORM/POLLWRNORM)
+    bool wait_events(short, std::chrono::milliseconds);
+
+    // Gather send starting at the byte offset of the buffers, return the number of bytes written
+    std::size_t send_gather(std::span<const std::span<const std::byte>>, std::size_t, std::chrono::milliseconds);
+
   public:
     win_socket();
     ~win_socket();
@@ -60,6 +68,46 @@ namespace nes::so {
     // I/O
     void send(std::span<const std::byte>);
     std::vector<std::byte> receive();
+
+    // Send until all data is written or time expire, return the number of bytes written
+    std::size_t send(std::span<const std::byte>, std::chrono::milliseconds);
+
+    // Gather send, the buffers are written in sequence without concatenation (header + body + trailer)
+    void send(std::span<const std::span<const std::byte>>);
+    std::size_t send(std::span<const std::span<const std::byte>>, std::chrono::milliseconds);
+
+    // File send from offset (read and send), the length is truncated at the end of the file
+    using native_file_type = void*;
+    void send_file(native_file_type, std::uint64_t offset = 0, std::uint64_t length = static_cast<std::uint64_t>(-1));
+    void send_file(const std::filesystem::path&, std::uint64_t offset = 0,
+      std::uint64_t length = static_cast<std::uint64_t>(-1));
+
+    // Send until all the file data is written or time expire, return the number of bytes written
+    std::uint64_t send_file(native_file_type, std::uint64_t, std::uint64_t, std::chrono::milliseconds);
+    std::uint64_t send_file(const std::filesystem::path&, std::uint64_t, std::uint64_t, std::chrono::milliseconds);
+
+    // Receive directly in the buffer until it is full or no more data, return the number of bytes
+    std::size_t receive_into(std::span<std::byte>);
+
+    // Scatter receive, the buffers are filled in sequence (header + payload in its final place)
+    std::size_t receive_into(std::span<const std::span<std::byte>>);
+
+    // Block until there is data to receive/room to send or time expire (true if ready)
+    bool wait_readable(std::chrono::milliseconds);
+    bool wait_writable(std::chrono::milliseconds);
+
+    // Limit of not sent bytes in the kernel buffer (TCP_NOTSENT_LOWAT), false if not supported
+    bool set_notsent_lowat(std::size_t);
+
+    // Zero copy send for the sends >= threshold (SO_ZEROCOPY + MSG_ZEROCOPY), false if not supported
+    // The buffers must stay unchanged until the zero copy sends are completed, the send without time waits it
+    bool enable_zerocopy(std::size_t);
+    std::uint32_t zerocopy_sent() const;
+    std::uint32_t zerocopy_completed();
+    std::uint32_t zerocopy_copied() const;
+
+    // Wait until all the zero copy sends are completed (the buffers can be reused)
+    bool wait_zerocopy(std::chrono::milliseconds);
   };
 
 }
@@ -0,0 +1,161 @@
+#include "buffer_pool.h"
+
+#include <bit>
+#include <new>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+using namespace std;
+
+namespace nes {
+
+  namespace {
+    // Index of the smallest class that fits the size
+    size_t size_class(size_t size)
+    {
+      return size <= buffer_pool::min_block ? 0
+                                            : bit_width(size - 1) - bit_width(buffer_pool::min_block - 1);
+    }
+
+    size_t class_size(size_t idx)
+    {
+      return buffer_pool::min_block << idx;
+    }
+  }
+
+  buffer_pool::buffer_pool(size_t max_cached, bool huge_pages, pmr::memory_resource* upstream)
+    : m_max_cached { max_cached }
+    , m_huge_pages { huge_pages }
+    , m_upstream { upstream }
+  {
+
+  }
+
+  buffer_pool::~buffer_pool()
+  {
+    this->trim();
+  }
+
+  buffer_pool& buffer_pool::thread_local_pool()
+  {
+    thread_local buffer_pool pool;
+    return pool;
+  }
+
+  size_t buffer_pool::cached() const
+  {
+    return m_cached;
+  }
+
+  size_t buffer_pool::max_cached() const
+  {
+    return m_max_cached;
+  }
+
+  bool buffer_pool::huge_pages() const
+  {
+    return m_huge_pages;
+  }
+
+  void buffer_pool::trim(size_t max_cached)
+  {
+    // Biggest blocks first, they give back more memory
+    for (auto idx = class_count; idx-- > 0 && m_cached > max_cached;)
+      while (!m_free[idx].empty() && m_cached > max_cached)
+      {
+        this->deallocate_block(m_free[idx].back(), class_size(idx));
+        m_free[idx].pop_back();
+        m_cached -= class_size(idx);
+      }
+
+    // Shrink the lists emptied by the spike
+    for (auto& free_list : m_free)
+      if (free_list.empty())
+        free_list.shrink_to_fit();
+  }
+
+  void* buffer_pool::allocate_block(size_t size)
+  {
+#ifndef _WIN32
+    if (m_huge_pages && size >= huge_page_size)
+    {
+      // Reserved huge pages first, then transparent huge pages
+      void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p == MAP_FAILED)
+      {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+          throw bad_alloc {};
+
+        madvise(p, size, MADV_HUGEPAGE);
+      }
+
+      return p;
+    }
+#endif
+
+    return m_upstream->allocate(size, alignof(max_align_t));
+  }
+
+  void buffer_pool::deallocate_block(void* p, size_t size)
+  {
+#ifndef _WIN32
+    if (m_huge_pages && size >= huge_page_size)
+    {
+      munmap(p, size);
+      return;
+    }
+#endif
+
+    m_upstream->deallocate(p, size, alignof(max_align_t));
+  }
+
+  void* buffer_pool::do_allocate(size_t bytes, size_t alignment)
+  {
+    // Out of the classes
+    if (bytes > max_block || alignment > alignof(max_align_t))
+      return m_upstream->allocate(bytes, alignment);
+
+    const auto idx = size_class(bytes);
+    if (auto& free_list = m_free[idx]; !free_list.empty())
+    {
+      auto p = free_list.back();
+      free_list.pop_back();
+      m_cached -= class_size(idx);
+
+      return p;
+    }
+
+    return this->allocate_block(class_size(idx));
+  }
+
+  void buffer_pool::do_deallocate(void* p, size_t bytes, size_t alignment)
+  {
+    if (bytes > max_block || alignment > alignof(max_align_t))
+    {
+      m_upstream->deallocate(p, bytes, alignment);
+      return;
+    }
+
+    // Cache the block for reuse, unless the limit is reached
+    const auto idx = size_class(bytes);
+    if (m_cached + class_size(idx) > m_max_cached)
+    {
+      this->deallocate_block(p, class_size(idx));
+      return;
+    }
+
+    try {
+      m_free[idx].push_back(p);
+      m_cached += class_size(idx);
+    } catch (const bad_alloc&) {
+      this->deallocate_block(p, class_size(idx));
+    }
+  }
+
+  bool buffer_pool::do_is_equal(const pmr::memory_resource& other) const noexcept
+  {
+    return this == &other;
+  }
+
+}
@@ -2,11 +2,30 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <stdexcept>
 #include "nes_exc.h"
 
+// x86 SIMD, SSE2 is baseline in x86-64 and AVX2 is selected at runtime (GCC/Clang)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define NES_BYTE_OP_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#  define NES_BYTE_OP_AVX2
+#  define NES_BYTE_OP_AVX2_TARGET
+#  include <immintrin.h>
+#elif defined(NES_BYTE_OP_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#  define NES_BYTE_OP_AVX2
+#  define NES_BYTE_OP_AVX2_DISPATCH
+#  define NES_BYTE_OP_AVX2_TARGET [[gnu::target("avx2")]]
+#  include <immintrin.h>
+#endif
+
 using namespace std;
 namespace rng = std::ranges;
 
@@ -326,4 +345,89 @@ namespace nes {
     return { as_bytes(span { str })};
   }
 
+  // Aux first byte scan
+  namespace {
+    const byte* find_byte_scalar(const byte* first, const byte* last, byte value)
+    {
+      return find(first, last, value);
+    }
+
+    #ifdef NES_BYTE_OP_SSE2
+    const byte* find_byte_sse2(const byte* first, const byte* last, byte value)
+    {
+      // Compare 16 bytes at a time, the mask bit set is the match position
+      const __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+      for (; last - first >= 16; first += 16)
+      {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        if (mask)
+          return first + countr_zero(mask);
+      }
+
+      return find_byte_scalar(first, last, value);
+    }
+    #endif
+
+    #ifdef NES_BYTE_OP_AVX2
+    NES_BYTE_OP_AVX2_TARGET
+    const byte* find_byte_avx2(const byte* first, const byte* last, byte value)
+    {
+      // Compare 32 bytes at a time, the tail goes to the narrower scan
+      const __m256i needle = _mm256_set1_epi8(static_cast<char>(value));
+      for (; last - first >= 32; first += 32)
+      {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask)
+          return first + countr_zero(mask);
+      }
+
+      return find_byte_sse2(first, last, value);
+    }
+    #endif
+
+    const byte* find_byte(const byte* first, const byte* last, byte value)
+    {
+      #if defined(NES_BYTE_OP_AVX2_DISPATCH)
+      static const bool has_avx2 = __builtin_cpu_supports("avx2");
+      if (has_avx2)
+        return find_byte_avx2(first, last, value);
+      return find_byte_sse2(first, last, value);
+      #elif defined(NES_BYTE_OP_AVX2)
+      return find_byte_avx2(first, last, value);
+      #elif defined(NES_BYTE_OP_SSE2)
+      return find_byte_sse2(first, last, value);
+      #else
+      return find_byte_scalar(first, last, value);
+      #endif
+    }
+  }
+
+  size_t bin_find(span<const byte> data, span<const byte> pattern, size_t pos /*= 0*/)
+  {
+    if (pos > data.size() || data.size() - pos < pattern.size())
+      return data.size();
+
+    if (pattern.empty())
+      return pos;
+
+    // Locate the candidates by the first byte and confirm the rest
+    const byte* first = data.data() + pos;
+    const byte* last = data.data() + data.size() - pattern.size() + 1;
+    while (first != last)
+    {
+      first = find_byte(first, last, pattern.front());
+      if (first == last)
+        break;
+
+      if (memcmp(first + 1, pattern.data() + 1, pattern.size() - 1) == 0)
+        return static_cast<size_t>(first - data.data());
+
+      ++first;
+    }
+
+    return data.size();
+  }
+
 }
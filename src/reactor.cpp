@@ -0,0 +1,176 @@
+#include "reactor.h"
+
+#include <sys/epoll.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <unistd.h>
+#include "cfg.h"
+#include "nes_exc.h"
+using namespace std;
+using namespace std::chrono;
+using namespace nes;
+
+namespace nes::net {
+
+  constexpr int EPOLL_INVALID = -1;
+
+  // Aux events conversion
+  namespace {
+    uint32_t to_epoll_events(io_event events)
+    {
+      // Always edge-triggered and peer hangup aware
+      uint32_t ret = EPOLLET | EPOLLRDHUP;
+      if (has_event(events, io_event::readable))
+        ret |= EPOLLIN;
+      if (has_event(events, io_event::writable))
+        ret |= EPOLLOUT;
+
+      return ret;
+    }
+
+    io_event from_epoll_events(uint32_t events)
+    {
+      io_event ret = io_event::none;
+      if (events & EPOLLIN)
+        ret = ret | io_event::readable;
+      if (events & EPOLLOUT)
+        ret = ret | io_event::writable;
+      if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        ret = ret | io_event::closed;
+
+      return ret;
+    }
+  }
+
+  reactor::reactor()
+    : m_epoll_fd { epoll_create1(EPOLL_CLOEXEC) }
+  {
+    if (m_epoll_fd == EPOLL_INVALID)
+      throw nes_exc { "Error on create epoll in linux syscall. Error {}: '{}'.", errno, strerror(errno) };
+  }
+
+  reactor::~reactor()
+  {
+    if (m_epoll_fd != EPOLL_INVALID)
+      close(m_epoll_fd);
+  }
+
+  reactor::reactor(reactor&& other) noexcept
+    : m_epoll_fd { other.m_epoll_fd }
+    , m_handlers { move(other.m_handlers) }
+    , m_events { move(other.m_events) }
+  {
+    other.m_epoll_fd = EPOLL_INVALID;
+  }
+
+  reactor& reactor::operator=(reactor&& other) noexcept
+  {
+    swap(m_epoll_fd, other.m_epoll_fd);
+    swap(m_handlers, other.m_handlers);
+    swap(m_events, other.m_events);
+
+    return *this;
+  }
+
+  void reactor::add(native_handle_type fd, io_event events, handler_type handler)
+  {
+    if (m_handlers.contains(fd))
+      throw nes_exc { "Handle {} already registered in the reactor.", fd };
+
+    epoll_event ev {};
+    ev.events = to_epoll_events(events);
+    ev.data.fd = fd;
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+      throw nes_exc { "Reactor cannot register handle {}. Error {}: '{}'.", fd, errno, strerror(errno) };
+
+    m_handlers.emplace(fd, make_shared<handler_type>(move(handler)));
+  }
+
+  void reactor::modify(native_handle_type fd, io_event events)
+  {
+    if (!m_handlers.contains(fd))
+      throw nes_exc { "Handle {} not registered in the reactor.", fd };
+
+    epoll_event ev {};
+    ev.events = to_epoll_events(events);
+    ev.data.fd = fd;
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &ev) != 0)
+      throw nes_exc { "Reactor cannot modify handle {}. Error {}: '{}'.", fd, errno, strerror(errno) };
+  }
+
+  void reactor::remove(native_handle_type fd)
+  {
+    // A closed handle was already removed by the kernel, only the handler remains
+    if (m_handlers.erase(fd))
+      epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+
+  void reactor::add(socket_serv& serv, function<void(socket)> handler)
+  {
+    this->add(serv, io_event::readable, [&serv, handler = move(handler)](io_event) {
+      // Drain all pending clients (edge-triggered)
+      while (auto cli = serv.accept())
+        handler(move(*cli));
+    });
+  }
+
+  void reactor::add(tls_socket_serv& serv, function<void(tls_socket)> handler)
+  {
+    this->add(serv, io_event::readable, [&serv, handler = move(handler)](io_event) {
+      // Drain all pending clients (edge-triggered)
+      while (auto cli = serv.accept())
+        handler(move(*cli));
+    });
+  }
+
+  bool reactor::contains(native_handle_type fd) const
+  {
+    return m_handlers.contains(fd);
+  }
+
+  size_t reactor::size() const
+  {
+    return m_handlers.size();
+  }
+
+  size_t reactor::run_once(milliseconds time_expire)
+  {
+    if (m_events.size() != cfg::net::reactor_max_events)
+      m_events.resize(cfg::net::reactor_max_events);
+
+    int timeout_ms = -1;
+    if (time_expire.count() >= 0)
+      timeout_ms = static_cast<int>(min<milliseconds::rep>(time_expire.count(), numeric_limits<int>::max()));
+
+    int qtde = epoll_wait(m_epoll_fd, m_events.data(), static_cast<int>(m_events.size()), timeout_ms);
+    if (qtde < 0)
+    {
+      // Interrupted by a signal, no events
+      if (errno == EINTR)
+        return 0;
+
+      throw nes_exc { "Error on reactor wait. Error {}: '{}'.", errno, strerror(errno) };
+    }
+
+    size_t dispatched = 0;
+    for (const auto& ev : span { m_events }.first(static_cast<size_t>(qtde)))
+    {
+      // Handler may be removed by an earlier handler in this same round
+      auto it = m_handlers.find(ev.data.fd);
+      if (it == m_handlers.end())
+        continue;
+
+      // Keep alive while running, even if the handler removes itself
+      auto handler = it->second;
+      (*handler)(from_epoll_events(ev.events));
+      dispatched++;
+    }
+
+    return dispatched;
+  }
+
+}
@@ -0,0 +1,159 @@
+#include "ring_buffer.h"
+
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include "nes_exc.h"
+#include "socket.h"
+#include "tls_socket.h"
+using namespace std;
+
+namespace nes {
+
+  // Aux RAII memfd handle
+  namespace {
+    class memfd_raii final
+    {
+      int m_fd;
+    public:
+      memfd_raii(int fd) : m_fd { fd } {};
+      ~memfd_raii() { if (m_fd >= 0) close(m_fd); };
+      int handle() const { return m_fd; };
+    };
+  }
+
+  ring_buffer::ring_buffer(size_t min_capacity)
+  {
+    // The mappings must be page aligned
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto capacity = (max(min_capacity, size_t { 1 }) + page_size - 1) / page_size * page_size;
+
+    memfd_raii fd { memfd_create("nes_ring_buffer", MFD_CLOEXEC) };
+    if (fd.handle() < 0)
+      throw nes_exc { "Error on create the ring buffer memfd. Error {}: '{}'.", errno, strerror(errno) };
+
+    if (ftruncate(fd.handle(), static_cast<off_t>(capacity)) != 0)
+      throw nes_exc { "Error on size the ring buffer to {}B. Error {}: '{}'.", capacity, errno, strerror(errno) };
+
+    // Reserve the address space, then map the same pages in both halves
+    void* base = mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+      throw nes_exc { "Error on reserve the ring buffer memory. Error {}: '{}'.", errno, strerror(errno) };
+
+    auto data = static_cast<byte*>(base);
+    for (auto half : { data, data + capacity })
+      if (mmap(half, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd.handle(), 0) == MAP_FAILED)
+      {
+        auto err = errno;
+        munmap(base, 2 * capacity);
+        throw nes_exc { "Error on map the ring buffer memory. Error {}: '{}'.", err, strerror(err) };
+      }
+
+    // All ok, can set the class
+    m_data = data;
+    m_capacity = capacity;
+  }
+
+  ring_buffer::~ring_buffer()
+  {
+    if (m_data)
+      munmap(m_data, 2 * m_capacity);
+  }
+
+  ring_buffer::ring_buffer(ring_buffer&& other) noexcept
+    : m_data { other.m_data }
+    , m_capacity { other.m_capacity }
+    , m_read { other.m_read }
+    , m_write { other.m_write }
+  {
+    other.m_data = nullptr;
+    other.m_capacity = other.m_read = other.m_write = 0;
+  }
+
+  ring_buffer& ring_buffer::operator=(ring_buffer&& other) noexcept
+  {
+    swap(m_data, other.m_data);
+    swap(m_capacity, other.m_capacity);
+    swap(m_read, other.m_read);
+    swap(m_write, other.m_write);
+
+    return *this;
+  }
+
+  size_t ring_buffer::capacity() const
+  {
+    return m_capacity;
+  }
+
+  size_t ring_buffer::size() const
+  {
+    return m_write - m_read;
+  }
+
+  bool ring_buffer::empty() const
+  {
+    return m_write == m_read;
+  }
+
+  bool ring_buffer::full() const
+  {
+    return this->size() == m_capacity;
+  }
+
+  span<const byte> ring_buffer::readable() const
+  {
+    return { m_data + m_read, this->size() };
+  }
+
+  void ring_buffer::consume(size_t qtde)
+  {
+    if (qtde > this->size())
+      throw nes_exc { "Ring buffer consume of {}B with only {}B readable.", qtde, this->size() };
+
+    m_read += qtde;
+
+    // Back to the first half, the second is the same memory
+    if (m_read >= m_capacity)
+    {
+      m_read -= m_capacity;
+      m_write -= m_capacity;
+    }
+  }
+
+  span<byte> ring_buffer::writable()
+  {
+    return { m_data + m_write, m_capacity - this->size() };
+  }
+
+  void ring_buffer::commit(size_t qtde)
+  {
+    if (qtde > m_capacity - this->size())
+      throw nes_exc { "Ring buffer commit of {}B with only {}B free.", qtde, m_capacity - this->size() };
+
+    m_write += qtde;
+  }
+
+  void ring_buffer::clear()
+  {
+    m_read = m_write = 0;
+  }
+
+}
+
+namespace nes::net {
+
+  template <class S>
+  size_t receive_into(S& sock, ring_buffer& ring)
+  {
+    const auto qtde = sock.receive_into(ring.writable());
+    ring.commit(qtde);
+
+    return qtde;
+  }
+
+  // Template instantiations
+  template size_t receive_into(socket&, ring_buffer&);
+  template size_t receive_into(tls_socket&, ring_buffer&);
+
+}
@@ -0,0 +1,104 @@
+#include "send_queue.h"
+
+#include <span>
+#include <vector>
+#include "nes_exc.h"
+#include "socket.h"
+#include "tls_socket.h"
+using namespace std;
+using namespace std::chrono_literals;
+using namespace nes;
+
+namespace nes::net {
+
+  send_queue::send_queue(size_t low_watermark, size_t high_watermark)
+  {
+    this->set_watermarks(low_watermark, high_watermark);
+  }
+
+  void send_queue::set_watermarks(size_t low_watermark, size_t high_watermark)
+  {
+    if (low_watermark > high_watermark)
+      throw nes_exc { "Send queue low watermark ({}B) greater than the high ({}B).", low_watermark, high_watermark };
+
+    m_low_watermark = low_watermark;
+    m_high_watermark = high_watermark;
+    this->update_blocked();
+  }
+
+  void send_queue::update_blocked()
+  {
+    if (m_queue.size() >= m_high_watermark)
+      m_blocked = true;
+    else if (m_queue.size() <= m_low_watermark)
+      m_blocked = false;
+  }
+
+  void send_queue::push(shared_buffer data)
+  {
+    m_queue.append(move(data));
+    this->update_blocked();
+  }
+
+  size_t send_queue::size() const
+  {
+    return m_queue.size();
+  }
+
+  bool send_queue::empty() const
+  {
+    return m_queue.empty();
+  }
+
+  bool send_queue::blocked() const
+  {
+    return m_blocked;
+  }
+
+  template <class S>
+  size_t send_queue::flush(S& sock)
+  {
+    constexpr bool has_zerocopy = requires { sock.zerocopy_sent(); };
+
+    size_t sent = 0;
+    if (!m_queue.empty())
+    {
+      vector<span<const byte>> buffers;
+      buffers.reserve(m_queue.slices().size());
+      for (const auto& slice : m_queue.slices())
+        buffers.push_back(slice.bytes());
+
+      // No wait, the rest goes in the next writable readiness
+      uint32_t zerocopy_sent = 0;
+      if constexpr (has_zerocopy)
+        zerocopy_sent = sock.zerocopy_sent();
+
+      sent = sock.send(span<const span<const byte>> { buffers }, 0ms);
+
+      // The kernel still reads the pages of zero copy sends
+      if constexpr (has_zerocopy)
+        if (sock.zerocopy_sent() != zerocopy_sent)
+          m_zerocopy_pending.emplace_back(sock.zerocopy_sent(), m_queue.slice(0, sent));
+
+      m_queue.consume(sent);
+      this->update_blocked();
+    }
+
+    // Release the completed (the counters can wrap)
+    if constexpr (has_zerocopy)
+      if (!m_zerocopy_pending.empty())
+      {
+        const auto completed = sock.zerocopy_completed();
+        erase_if(m_zerocopy_pending, [completed] (const auto& p) {
+          return static_cast<int32_t>(completed - p.first) >= 0;
+        });
+      }
+
+    return sent;
+  }
+
+  // Template instantiations
+  template size_t send_queue::flush(socket_so_impl&);
+  template size_t send_queue::flush(tls_socket&);
+
+}
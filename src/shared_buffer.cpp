@@ -0,0 +1,166 @@
+#include "shared_buffer.h"
+
+#include <algorithm>
+#include "nes_exc.h"
+using namespace std;
+
+namespace nes {
+
+  shared_buffer::shared_buffer(vector<byte> data)
+    : m_storage { make_shared<const vector<byte>>(move(data)) }
+    , m_data { *m_storage }
+  {
+
+  }
+
+  shared_buffer shared_buffer::copy_of(span<const byte> data)
+  {
+    return shared_buffer { vector<byte> { data.begin(), data.end() } };
+  }
+
+  size_t shared_buffer::size() const
+  {
+    return m_data.size();
+  }
+
+  bool shared_buffer::empty() const
+  {
+    return m_data.empty();
+  }
+
+  const byte* shared_buffer::data() const
+  {
+    return m_data.data();
+  }
+
+  const byte* shared_buffer::begin() const
+  {
+    return m_data.data();
+  }
+
+  const byte* shared_buffer::end() const
+  {
+    return m_data.data() + m_data.size();
+  }
+
+  span<const byte> shared_buffer::bytes() const
+  {
+    return m_data;
+  }
+
+  shared_buffer shared_buffer::slice(size_t offset, size_t len) const
+  {
+    if (offset > m_data.size())
+      throw nes_exc { "Slice offset {} out of the buffer size {}.", offset, m_data.size() };
+
+    shared_buffer ret;
+    ret.m_storage = m_storage;
+    ret.m_data = m_data.subspan(offset, min(len, m_data.size() - offset));
+
+    return ret;
+  }
+
+  long shared_buffer::use_count() const
+  {
+    return m_storage.use_count();
+  }
+
+  buffer_chain::buffer_chain(initializer_list<shared_buffer> slices)
+  {
+    for (const auto& s : slices)
+      this->append(s);
+  }
+
+  void buffer_chain::append(shared_buffer slice)
+  {
+    // Empty slices only keep the storage alive
+    if (slice.empty())
+      return;
+
+    m_size += slice.size();
+    m_slices.push_back(move(slice));
+  }
+
+  void buffer_chain::append(const buffer_chain& other)
+  {
+    m_slices.insert(m_slices.end(), other.m_slices.begin(), other.m_slices.end());
+    m_size += other.m_size;
+  }
+
+  size_t buffer_chain::size() const
+  {
+    return m_size;
+  }
+
+  bool buffer_chain::empty() const
+  {
+    return m_size == 0;
+  }
+
+  span<const shared_buffer> buffer_chain::slices() const
+  {
+    return m_slices;
+  }
+
+  buffer_chain buffer_chain::slice(size_t offset, size_t len) const
+  {
+    if (offset > m_size)
+      throw nes_exc { "Slice offset {} out of the chain size {}.", offset, m_size };
+
+    buffer_chain ret;
+    len = min(len, m_size - offset);
+    for (const auto& s : m_slices)
+    {
+      if (len == 0)
+        break;
+
+      // Skip the slices before the offset
+      if (offset >= s.size())
+      {
+        offset -= s.size();
+        continue;
+      }
+
+      auto part = s.slice(offset, len);
+      len -= part.size();
+      offset = 0;
+      ret.append(move(part));
+    }
+
+    return ret;
+  }
+
+  void buffer_chain::consume(size_t qtde)
+  {
+    if (qtde > m_size)
+      throw nes_exc { "Chain consume of {}B with only {}B.", qtde, m_size };
+
+    m_size -= qtde;
+
+    // Whole slices first, then the remainder in the new front
+    auto it = m_slices.begin();
+    for (; it != m_slices.end() && qtde >= it->size(); ++it)
+      qtde -= it->size();
+    m_slices.erase(m_slices.begin(), it);
+
+    if (qtde > 0)
+      m_slices.front() = m_slices.front().slice(qtde);
+  }
+
+  void buffer_chain::clear()
+  {
+    m_slices.clear();
+    m_size = 0;
+  }
+
+  vector<byte> buffer_chain::flatten() const
+  {
+    vector<byte> ret;
+    ret.reserve(m_size);
+    for (const auto& s : m_slices)
+      ret.insert(ret.end(), s.begin(), s.end());
+
+    return ret;
+  }
+
+}
@@ -79,6 +79,174 @@ namespace nes::net {
     return m_sock_so.receive();
   }
 
+  template <class S>
+  pmr::vector<byte> socket_tmpl<S>::receive(pmr::memory_resource* mr)
+  {
+    // Grow by packets directly in the buffer tail until the available data ends
+    return receive_available(*this, pmr::vector<byte> { mr });
+  }
+
+  template <class S>
+  shared_buffer socket_tmpl<S>::receive_shared()
+  {
+    return shared_buffer { this->receive() };
+  }
+
+  template <class S>
+  void socket_tmpl<S>::send(const buffer_chain& data)
+  {
+    vector<span<const byte>> buffers;
+    buffers.reserve(data.slices().size());
+    for (const auto& slice : data.slices())
+      buffers.push_back(slice.bytes());
+
+    m_sock_so.send(span<const span<const byte>> { buffers });
+  }
+
+  template <class S>
+  size_t socket_tmpl<S>::send(span<const byte> data, milliseconds time_expire)
+  {
+    return m_sock_so.send(data, time_expire);
+  }
+
+  template <class S>
+  size_t socket_tmpl<S>::send(string_view data_str, milliseconds time_expire)
+  {
+    return m_sock_so.send(as_bytes(span { data_str.begin(), data_str.end() }), time_expire);
+  }
+
+  template <class S>
+  void socket_tmpl<S>::send(span<const span<const byte>> buffers)
+  {
+    m_sock_so.send(buffers);
+  }
+
+  template <class S>
+  size_t socket_tmpl<S>::send(span<const span<const byte>> buffers, milliseconds time_expire)
+  {
+    return m_sock_so.send(buffers, time_expire);
+  }
+
+  template <class S>
+  void socket_tmpl<S>::send_file(native_file_type file, uint64_t offset, uint64_t length)
+  {
+    m_sock_so.send_file(file, offset, length);
+  }
+
+  template <class S>
+  void socket_tmpl<S>::send_file(const filesystem::path& path, uint64_t offset, uint64_t length)
+  {
+    m_sock_so.send_file(path, offset, length);
+  }
+
+  template <class S>
+  uint64_t socket_tmpl<S>::send_file(native_file_type file, uint64_t offset, uint64_t length,
+    milliseconds time_expire)
+  {
+    return m_sock_so.send_file(file, offset, length, time_expire);
+  }
+
+  template <class S>
+  uint64_t socket_tmpl<S>::send_file(const filesystem::path& path, uint64_t offset, uint64_t length,
+    milliseconds time_expire)
+  {
+    return m_sock_so.send_file(path, offset, length, time_expire);
+  }
+
+  template <class S>
+  size_t socket_tmpl<S>::receive_into(span<byte> buffer)
+  {
+    return m_sock_so.receive_into(buffer);
+  }
+
+  template <class S>
+  size_t socket_tmpl<S>::receive_into(span<const span<byte>> buffers)
+  {
+    return m_sock_so.receive_into(buffers);
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::wait_readable(milliseconds time_expire)
+  {
+    return m_sock_so.wait_readable(time_expire);
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::wait_writable(milliseconds time_expire)
+  {
+    return m_sock_so.wait_writable(time_expire);
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::enqueue_send(span<const byte> data)
+  {
+    return this->enqueue_send(shared_buffer::copy_of(data));
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::enqueue_send(shared_buffer data)
+  {
+    // Try to write right away, only the remaining waits in the queue
+    m_send_queue.push(move(data));
+    this->flush_send();
+
+    return !m_send_queue.blocked();
+  }
+
+  template <class S>
+  size_t socket_tmpl<S>::flush_send()
+  {
+    return m_send_queue.flush(m_sock_so);
+  }
+
+  template <class S>
+  size_t socket_tmpl<S>::send_queued() const
+  {
+    return m_send_queue.size();
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::send_blocked() const
+  {
+    return m_send_queue.blocked();
+  }
+
+  template <class S>
+  void socket_tmpl<S>::set_send_watermarks(size_t low_watermark, size_t high_watermark)
+  {
+    m_send_queue.set_watermarks(low_watermark, high_watermark);
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::set_notsent_lowat(size_t qtde)
+  {
+    return m_sock_so.set_notsent_lowat(qtde);
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::enable_zerocopy(size_t threshold)
+  {
+    return m_sock_so.enable_zerocopy(threshold);
+  }
+
+  template <class S>
+  uint32_t socket_tmpl<S>::zerocopy_sent() const
+  {
+    return m_sock_so.zerocopy_sent();
+  }
+
+  template <class S>
+  uint32_t socket_tmpl<S>::zerocopy_completed()
+  {
+    return m_sock_so.zerocopy_completed();
+  }
+
+  template <class S>
+  bool socket_tmpl<S>::wait_zerocopy(milliseconds time_expire)
+  {
+    return m_sock_so.wait_zerocopy(time_expire);
+  }
+
   template <class S>
   template <class R, class P>
   pair<vector<byte>, size_t>
@@ -112,6 +280,31 @@ namespace nes::net {
     receive_remaining(*this, data, total_size, time_expire);
   }
 
+  template <class S>
+  template <class R, class P>
+  pair<size_t, size_t>
+  socket_tmpl<S>::receive_until_delimiter(span<byte> buffer, span<const byte> delim, duration<R, P> time_expire)
+  {
+    using nes::net::receive_until_delimiter;
+    return receive_until_delimiter(*this, buffer, delim, time_expire);
+  }
+
+  template <class S>
+  template <class R, class P>
+  void socket_tmpl<S>::receive_until_size(span<byte> buffer, duration<R, P> time_expire)
+  {
+    using nes::net::receive_until_size;
+    receive_until_size(*this, buffer, time_expire);
+  }
+
+  template <class S>
+  template <class R, class P>
+  size_t socket_tmpl<S>::receive_at_least(span<byte> buffer, size_t at_least_size, duration<R, P> time_expire)
+  {
+    using nes::net::receive_at_least;
+    return receive_at_least(*this, buffer, at_least_size, time_expire);
+  }
+
   // Template class instanciation
   template class socket_tmpl<socket_so_impl>;
 
@@ -126,4 +319,12 @@ namespace nes::net {
   template vector<byte> socket_tmpl<socket_so_impl>::receive_until_size(size_t, milliseconds);
   template vector<byte> socket_tmpl<socket_so_impl>::receive_at_least(size_t, seconds);
   template void socket_tmpl<socket_so_impl>::receive_remaining(vector<byte>&, size_t, seconds);
+  template pair<size_t, size_t>
+  socket_tmpl<socket_so_impl>::receive_until_delimiter(span<byte>, span<const byte>, seconds);
+  template pair<size_t, size_t>
+  socket_tmpl<socket_so_impl>::receive_until_delimiter(span<byte>, span<const byte>, milliseconds);
+  template void socket_tmpl<socket_so_impl>::receive_until_size(span<byte>, seconds);
+  template void socket_tmpl<socket_so_impl>::receive_until_size(span<byte>, milliseconds);
+  template size_t socket_tmpl<socket_so_impl>::receive_at_least(span<byte>, size_t, seconds);
+  template size_t socket_tmpl<socket_so_impl>::receive_at_least(span<byte>, size_t, milliseconds);
 }
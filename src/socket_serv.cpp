@@ -34,6 +34,12 @@ namespace nes::net {
     return m_sock_so.has_client();
   }
 
+  template <class S>
+  typename socket_serv_tmpl<S>::native_handle_type socket_serv_tmpl<S>::native_handle() const
+  {
+    return m_sock_so.native_handle();
+  }
+
   template <class S>
   optional<socket> socket_serv_tmpl<S>::accept()
   {
@@ -1,7 +1,7 @@
 #include "socket_util.h"
 
 #include <algorithm>
-#include <thread>
+#include "byte_op.h"
 #include "cfg.h"
 #include "net_exc.h"
 #include "socket.h"
@@ -23,137 +23,307 @@ namespace nes::net {
     return cfg::net::wait_io_step_min + milliseconds { static_cast<milliseconds::rep>(interval_dif * retry_coef) };
   }
 
-  // Input Algorithms
+  template <class R, class P>
+  milliseconds remaining_time(steady_clock::time_point start, duration<R, P> time_expire)
+  {
+    const auto elapsed = steady_clock::now() - start;
+    if (elapsed >= time_expire)
+      return milliseconds { 0 };
+
+    return ceil<milliseconds>(time_expire - elapsed);
+  }
+
+  template <class S, class V>
+  V receive_available(S& sock, V ret)
+  {
+    while (true)
+    {
+      // TLS decrypted data can be bigger than a packet, receive it all at once
+      auto chunk_size = cfg::net::packet_size;
+      if constexpr (requires { sock.pending(); })
+        chunk_size = max(chunk_size, sock.pending());
+
+      const auto ret_size = ret.size();
+      ret.resize(ret_size + chunk_size);
+
+      size_t qtde = 0;
+      try {
+        qtde = sock.receive_into(span { ret }.subspan(ret_size));
+      } catch (...) {
+        if (!ret_size)
+          throw;
+      }
+      ret.resize(ret_size + qtde);
+
+      if (qtde < chunk_size)
+        return ret;
+    }
+  }
+
+  namespace {
+    // Receive the available data (up to a packet or max_size) directly in the tail of data, return the number of bytes
+    template <class S, class V>
+    size_t receive_append(S& sock, V& data, size_t max_size)
+    {
+      const auto data_size = data.size();
+      data.resize(data_size + min(cfg::net::packet_size, max_size));
+      const auto qtde = sock.receive_into(span { data }.subspan(data_size));
+      data.resize(data_size + qtde);
+
+      return qtde;
+    }
+
+    // Input Algorithms, the return buffer type (std::vector or std::pmr::vector) comes in ret
+    template <class V, class S, class R, class P>
+    pair<V, size_t> receive_until_delimiter_impl(S& sock, V ret, span<const byte> delim, duration<R, P> time_expire,
+      size_t max_size)
+    {
+      // Read data until receive the deliminator
+      // The time e size params sets the threasholds for the reading
+      const auto start = steady_clock::now();
+      while (steady_clock::now() - start < time_expire)
+      {
+        // Only the new data (with the delim size overlap) was not searched yet
+        const auto search_pos = !delim.empty() && ret.size() >= delim.size() ? ret.size() - delim.size() + 1 : 0;
+        // One byte over the maximum is enough to detect the excess (no overflow with a huge max_size)
+        const auto max_left = max_size - ret.size();
+        if (receive_append(sock, ret, max_left < cfg::net::packet_size ? max_left + 1 : cfg::net::packet_size) > 0)
+        {
+          // Excess data check
+          if (ret.size() > max_size)
+            throw socket_excess_data { "Received more data ({}B) than the maximum ({}B)!", ret.size(), max_size };
+
+          // Try to find the deliminator
+          if (auto pos = bin_find(ret, delim, search_pos); pos != ret.size())
+            return { move(ret), pos };
+        }
+        else
+        {
+          // If no data block until some arrives or the remaining time expire
+          sock.wait_readable(remaining_time(start, time_expire));
+        }
+      }
+
+      throw socket_timeout { "Wait time ({}) expired while especting the deliminator! Received {} bytes!",
+                              time_expire, ret.size() };
+    }
+
+    template <class V, class S, class R, class P>
+    V receive_until_size_impl(S& sock, V ret, size_t total_size, duration<R, P> time_expire)
+    {
+      ret.reserve(total_size);
+
+      // Read data until receive the exact number of bytes
+      const auto start = steady_clock::now();
+      while (steady_clock::now() - start < time_expire)
+      {
+        // Only the missing bytes, the buffer keeps the reserved size and the surplus stays in the socket
+        if (receive_append(sock, ret, total_size - ret.size()) > 0)
+        {
+          // Check if received all the data needed
+          if (ret.size() == total_size)
+            return ret;
+        }
+        else
+        {
+          // If no data block until some arrives or the remaining time expire
+          sock.wait_readable(remaining_time(start, time_expire));
+        }
+      }
+
+      throw socket_timeout { "Wait time {} expired, while expecting {} bytes! Received {} bytes!",
+                             time_expire, total_size, ret.size() };
+    }
+
+    template <class V, class S, class R, class P>
+    V receive_at_least_impl(S& sock, V ret, size_t at_least_size, duration<R, P> time_expire)
+    {
+      // Read data until receive the al least some number of bytes
+      const auto start = steady_clock::now();
+      while (steady_clock::now() - start < time_expire)
+      {
+        if (receive_append(sock, ret, cfg::net::packet_size) > 0)
+        {
+          // Check if received at least the data needed
+          if (ret.size() >= at_least_size)
+            return ret;
+        }
+        else
+        {
+          // If no data block until some arrives or the remaining time expire
+          sock.wait_readable(remaining_time(start, time_expire));
+        }
+      }
+
+      throw socket_timeout {
+        "Waiting time {} expired, while expecting at least {} bytes! Received {} bytes!",
+        time_expire, at_least_size, ret.size()
+      };
+    }
+  }
+
   template <class S, class R, class P>
   pair<vector<byte>, size_t> receive_until_delimiter(S& sock, span<const byte> delim, duration<R, P> time_expire,
     size_t max_size)
   {
-    vector<byte> ret;
+    return receive_until_delimiter_impl(sock, vector<byte> {}, delim, time_expire, max_size);
+  }
+
+  template <class S, class R, class P>
+  vector<byte> receive_until_size(S& sock, size_t total_size, duration<R, P> time_expire)
+  {
+    return receive_until_size_impl(sock, vector<byte> {}, total_size, time_expire);
+  }
 
-    // Read data until receive the deliminator
-    // The time e size params sets the threasholds for the reading
+  template <class S, class R, class P>
+  vector<byte> receive_at_least(S& sock, size_t at_least_size, duration<R, P> time_expire)
+  {
+    return receive_at_least_impl(sock, vector<byte> {}, at_least_size, time_expire);
+  }
+
+  template <class S, class R, class P>
+  pair<pmr::vector<byte>, size_t> receive_until_delimiter(S& sock, span<const byte> delim,
+    duration<R, P> time_expire, size_t max_size, pmr::memory_resource* mr)
+  {
+    return receive_until_delimiter_impl(sock, pmr::vector<byte> { mr }, delim, time_expire, max_size);
+  }
+
+  template <class S, class R, class P>
+  pmr::vector<byte> receive_until_size(S& sock, size_t total_size, duration<R, P> time_expire,
+    pmr::memory_resource* mr)
+  {
+    return receive_until_size_impl(sock, pmr::vector<byte> { mr }, total_size, time_expire);
+  }
+
+  template <class S, class R, class P>
+  pmr::vector<byte> receive_at_least(S& sock, size_t at_least_size, duration<R, P> time_expire,
+    pmr::memory_resource* mr)
+  {
+    return receive_at_least_impl(sock, pmr::vector<byte> { mr }, at_least_size, time_expire);
+  }
+
+  template <class S, class R, class P>
+  void receive_remaining(S& sock, vector<byte>& data, size_t total_size, duration<R, P> time_expire)
+  {
+    if (data.size() < total_size)
+    {
+      // Receive directly in the tail of data
+      const auto data_size = data.size();
+      data.resize(total_size);
+      try {
+        receive_until_size(sock, span { data }.subspan(data_size), time_expire);
+      } catch (...) {
+        data.resize(data_size);
+        throw;
+      }
+    }
+  }
+
+  template <class S, class R, class P>
+  pair<size_t, size_t> receive_until_delimiter(S& sock, span<byte> buffer, span<const byte> delim,
+    duration<R, P> time_expire)
+  {
+    size_t qtde_total = 0;
+
+    // Read data in the buffer until receive the deliminator
     const auto start = steady_clock::now();
-    milliseconds interval = cfg::net::wait_io_step_min;
-    size_t retry_count = 0;
     while (steady_clock::now() - start < time_expire)
     {
-      const auto data = sock.receive();
-      if (data.size() > 0)
+      const auto qtde = sock.receive_into(buffer.subspan(qtde_total));
+      if (qtde > 0)
       {
+        // Only the new data (with the delim size overlap) was not searched yet
+        const auto search_pos = !delim.empty() && qtde_total >= delim.size() ? qtde_total - delim.size() + 1 : 0;
+        qtde_total += qtde;
+        if (auto pos = bin_find(buffer.first(qtde_total), delim, search_pos); pos != qtde_total)
+          return { qtde_total, pos };
+
         // Excess data check
-        if (ret.size() + data.size() > max_size)
-          throw socket_excess_data { "Received more data ({}B) than the maximum ({}B)!",
-                                     ret.size() + data.size(), max_size };
-
-        // Collect in the return value and try to find the deliminator
-        ret.insert(ret.end(), data.begin(), data.end());
-        if (auto it = rng::search(ret, delim).begin(); it != ret.end())
-          return { ret, static_cast<size_t>(it - ret.begin()) };
-
-        // When read some data reset the progressive waiting
-        interval = cfg::net::wait_io_step_min;
-        retry_count = 0;
+        if (qtde_total == buffer.size())
+          throw socket_excess_data { "Buffer full ({}B) without the deliminator!", buffer.size() };
       }
       else
       {
-        // If no data receive sleeps (at every retry a little more time)
-        interval = calculate_interval_retry(++retry_count);
-        this_thread::sleep_for(interval);
+        // If no data block until some arrives or the remaining time expire
+        sock.wait_readable(remaining_time(start, time_expire));
       }
     }
 
     throw socket_timeout { "Wait time ({}) expired while especting the deliminator! Received {} bytes!",
-                            time_expire, ret.size() };
+                            time_expire, qtde_total };
   }
 
   template <class S, class R, class P>
-  vector<byte> receive_until_size(S& sock, size_t total_size, duration<R, P> time_expire)
+  void receive_until_size(S& sock, span<byte> buffer, duration<R, P> time_expire)
   {
-    vector<byte> ret;
+    size_t qtde_total = 0;
+    if (buffer.empty())
+      return;
 
-    // Read data until receive the exact number of bytes
+    // Read data until fill the buffer
     const auto start = steady_clock::now();
-    milliseconds interval = cfg::net::wait_io_step_min;
-    size_t retry_count = 0;
     while (steady_clock::now() - start < time_expire)
     {
-      const auto data = sock.receive();
-      if (data.size() > 0)
+      const auto qtde = sock.receive_into(buffer.subspan(qtde_total));
+      if (qtde > 0)
       {
-        // Excess data check
-        if (ret.size() + data.size() > total_size)
-          throw socket_excess_data { "Received more data ({}B) than the expected ({}B)!",
-                                     ret.size() + data.size(), total_size };
-
-        // Collect in the return value and check if received all the data needed
-        ret.insert(ret.end(), data.begin(), data.end());
-        if (ret.size() == total_size)
-          return ret;
-
-        // When read some data reset the progressive waiting
-        interval = cfg::net::wait_io_step_min;
-        retry_count = 0;
+        qtde_total += qtde;
+        if (qtde_total == buffer.size())
+          return;
       }
       else
       {
-        // If no data receive sleeps (at every retry a little more time)
-        interval = calculate_interval_retry(++retry_count);
-        this_thread::sleep_for(interval);
+        // If no data block until some arrives or the remaining time expire
+        sock.wait_readable(remaining_time(start, time_expire));
       }
     }
 
     throw socket_timeout { "Wait time {} expired, while expecting {} bytes! Received {} bytes!",
-                           time_expire, total_size, ret.size() };
+                           time_expire, buffer.size(), qtde_total };
   }
 
   template <class S, class R, class P>
-  vector<byte> receive_at_least(S& sock, size_t at_least_size, duration<R, P> time_expire)
+  size_t receive_at_least(S& sock, span<byte> buffer, size_t at_least_size, duration<R, P> time_expire)
   {
-    vector<byte> ret;
+    if (at_least_size > buffer.size())
+      throw socket_excess_data { "Buffer ({}B) smaller than the expected at least ({}B)!",
+                                 buffer.size(), at_least_size };
+
+    size_t qtde_total = 0;
+    if (at_least_size == 0)
+      return qtde_total;
 
     // Read data until receive the al least some number of bytes
     const auto start = steady_clock::now();
-    milliseconds interval = cfg::net::wait_io_step_min;
-    size_t retry_count = 0;
     while (steady_clock::now() - start < time_expire)
     {
-      const auto data = sock.receive();
-      if (data.size() > 0)
+      const auto qtde = sock.receive_into(buffer.subspan(qtde_total));
+      if (qtde > 0)
       {
-        // Collect in the return value and check if received at least the data needed
-        ret.insert(ret.end(), data.begin(), data.end());
-        if (ret.size() >= at_least_size)
-          return ret;
-
-        // When read some data reset the progressive waiting
-        interval = cfg::net::wait_io_step_min;
-        retry_count = 0;
+        qtde_total += qtde;
+        if (qtde_total >= at_least_size)
+          return qtde_total;
       }
       else
       {
-        // If no data receive sleeps (at every retry a little more time)
-        interval = calculate_interval_retry(++retry_count);
-        this_thread::sleep_for(interval);
+        // If no data block until some arrives or the remaining time expire
+        sock.wait_readable(remaining_time(start, time_expire));
       }
     }
 
     throw socket_timeout {
       "Waiting time {} expired, while expecting at least {} bytes! Received {} bytes!",
-      time_expire, at_least_size, ret.size()
+      time_expire, at_least_size, qtde_total
     };
   }
 
-  template <class S, class R, class P>
-  void receive_remaining(S& sock, vector<byte>& data, size_t total_size, duration<R, P> time_expire)
-  {
-    if (data.size() < total_size)
-    {
-      auto rem = receive_until_size(sock, total_size - data.size(), time_expire);
-      data.insert(data.end(), rem.begin(), rem.end());
-    }
-  }
-
   // Template instantiations (at end to work with gcc and clang)
+  template milliseconds remaining_time(steady_clock::time_point, seconds);
+  template milliseconds remaining_time(steady_clock::time_point, milliseconds);
+  template milliseconds remaining_time(steady_clock::time_point, duration<double>);
+
+  template vector<byte> receive_available(socket&, vector<byte>);
+  template pmr::vector<byte> receive_available(socket&, pmr::vector<byte>);
   template pair<vector<byte>, size_t> receive_until_delimiter(socket&, span<const byte>, seconds, size_t);
   template pair<vector<byte>, size_t> receive_until_delimiter(socket&, span<const byte>, milliseconds, size_t);
   template pair<vector<byte>, size_t> receive_until_delimiter(socket&, span<const byte>, duration<double>, size_t);
@@ -161,7 +331,23 @@ namespace nes::net {
   template vector<byte> receive_until_size(socket&, size_t, milliseconds);
   template vector<byte> receive_at_least(socket&, size_t, seconds);
   template void receive_remaining(socket&, vector<byte>&, size_t, seconds);
+  template pair<pmr::vector<byte>, size_t>
+  receive_until_delimiter(socket&, span<const byte>, seconds, size_t, pmr::memory_resource*);
+  template pair<pmr::vector<byte>, size_t>
+  receive_until_delimiter(socket&, span<const byte>, milliseconds, size_t, pmr::memory_resource*);
+  template pmr::vector<byte> receive_until_size(socket&, size_t, seconds, pmr::memory_resource*);
+  template pmr::vector<byte> receive_until_size(socket&, size_t, milliseconds, pmr::memory_resource*);
+  template pmr::vector<byte> receive_at_least(socket&, size_t, seconds, pmr::memory_resource*);
+  template pmr::vector<byte> receive_at_least(socket&, size_t, milliseconds, pmr::memory_resource*);
+  template pair<size_t, size_t> receive_until_delimiter(socket&, span<byte>, span<const byte>, seconds);
+  template pair<size_t, size_t> receive_until_delimiter(socket&, span<byte>, span<const byte>, milliseconds);
+  template void receive_until_size(socket&, span<byte>, seconds);
+  template void receive_until_size(socket&, span<byte>, milliseconds);
+  template size_t receive_at_least(socket&, span<byte>, size_t, seconds);
+  template size_t receive_at_least(socket&, span<byte>, size_t, milliseconds);
 
+  template vector<byte> receive_available(tls_socket&, vector<byte>);
+  template pmr::vector<byte> receive_available(tls_socket&, pmr::vector<byte>);
   template pair<vector<byte>, size_t> receive_until_delimiter(tls_socket&, span<const byte>, seconds, size_t);
   template pair<vector<byte>, size_t> receive_until_delimiter(tls_socket&, span<const byte>, milliseconds, size_t);
   template pair<vector<byte>, size_t> receive_until_delimiter(tls_socket&, span<const byte>, duration<double>, size_t);
@@ -169,4 +355,18 @@ namespace nes::net {
   template vector<byte> receive_until_size(tls_socket&, size_t, milliseconds);
   template vector<byte> receive_at_least(tls_socket&, size_t, seconds);
   template void receive_remaining(tls_socket&, vector<byte>&, size_t, seconds);
+  template pair<pmr::vector<byte>, size_t>
+  receive_until_delimiter(tls_socket&, span<const byte>, seconds, size_t, pmr::memory_resource*);
+  template pair<pmr::vector<byte>, size_t>
+  receive_until_delimiter(tls_socket&, span<const byte>, milliseconds, size_t, pmr::memory_resource*);
+  template pmr::vector<byte> receive_until_size(tls_socket&, size_t, seconds, pmr::memory_resource*);
+  template pmr::vector<byte> receive_until_size(tls_socket&, size_t, milliseconds, pmr::memory_resource*);
+  template pmr::vector<byte> receive_at_least(tls_socket&, size_t, seconds, pmr::memory_resource*);
+  template pmr::vector<byte> receive_at_least(tls_socket&, size_t, milliseconds, pmr::memory_resource*);
+  template pair<size_t, size_t> receive_until_delimiter(tls_socket&, span<byte>, span<const byte>, seconds);
+  template pair<size_t, size_t> receive_until_delimiter(tls_socket&, span<byte>, span<const byte>, milliseconds);
+  template void receive_until_size(tls_socket&, span<byte>, seconds);
+  template void receive_until_size(tls_socket&, span<byte>, milliseconds);
+  template size_t receive_at_least(tls_socket&, span<byte>, size_t, seconds);
+  template size_t receive_at_least(tls_socket&, span<byte>, size_t, milliseconds);
 }
@@ -0,0 +1,189 @@
+#include "stream_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include "byte_op.h"
+#include "cfg.h"
+#include "net_exc.h"
+#include "socket.h"
+#include "socket_util.h"
+#include "tls_socket.h"
+using namespace std;
+using namespace std::chrono;
+namespace rng = std::ranges;
+using namespace nes;
+
+namespace nes::net {
+
+  template <class S>
+  stream_reader<S>::stream_reader(S& sock)
+    : m_sock { sock }
+  {
+
+  }
+
+  template <class S>
+  S& stream_reader<S>::stream()
+  {
+    return m_sock;
+  }
+
+  template <class S>
+  size_t stream_reader<S>::buffered() const
+  {
+    return m_end - m_begin;
+  }
+
+  template <class S>
+  span<const byte> stream_reader<S>::buffered_data() const
+  {
+    return span { m_buffer }.subspan(m_begin, m_end - m_begin);
+  }
+
+  template <class S>
+  void stream_reader<S>::consume(size_t qtde)
+  {
+    m_begin += qtde;
+
+    // Empty, restart from the buffer begin
+    if (m_begin == m_end)
+      m_begin = m_end = 0;
+  }
+
+  template <class S>
+  size_t stream_reader<S>::fill()
+  {
+    // Make room for at least one packet, first reusing the consumed space
+    if (m_buffer.size() - m_end < cfg::net::packet_size)
+    {
+      if (m_begin > 0)
+      {
+        memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+        m_end -= m_begin;
+        m_begin = 0;
+      }
+
+      if (m_buffer.size() - m_end < cfg::net::packet_size)
+        m_buffer.resize(max(m_buffer.size() * 2, m_end + cfg::net::packet_size));
+    }
+
+    const auto qtde = m_sock.receive_into(span { m_buffer }.subspan(m_end));
+    m_end += qtde;
+
+    return qtde;
+  }
+
+  template <class S>
+  size_t stream_reader<S>::read_some(span<byte> buffer)
+  {
+    // Buffered data first, the connection only when there is nothing left
+    if (this->buffered())
+    {
+      const auto qtde = min(buffer.size(), this->buffered());
+      rng::copy(this->buffered_data().first(qtde), buffer.begin());
+      this->consume(qtde);
+
+      return qtde;
+    }
+
+    return m_sock.receive_into(buffer);
+  }
+
+  template <class S>
+  vector<byte> stream_reader<S>::read_some()
+  {
+    // The connection only when there is nothing left
+    if (!this->buffered())
+      this->fill();
+
+    const auto data = this->buffered_data();
+    vector<byte> ret { data.begin(), data.end() };
+    this->consume(data.size());
+
+    return ret;
+  }
+
+  template <class S>
+  template <class R, class P>
+  vector<byte> stream_reader<S>::read_until(span<const byte> delim, duration<R, P> time_expire, size_t max_size)
+  {
+    // The positions before search_pos was already checked in previous loops
+    size_t search_pos = 0;
+    const auto start = steady_clock::now();
+    while (true)
+    {
+      const auto data = this->buffered_data();
+      if (auto pos = bin_find(data, delim, search_pos); pos != data.size())
+      {
+        const auto msg_size = pos + delim.size();
+        if (msg_size > max_size)
+          throw socket_excess_data { "Received more data ({}B) than the maximum ({}B)!", msg_size, max_size };
+
+        vector<byte> ret { data.begin(), data.begin() + static_cast<ptrdiff_t>(msg_size) };
+        this->consume(msg_size);
+
+        return ret;
+      }
+
+      // Excess data check
+      if (data.size() >= max_size)
+        throw socket_excess_data { "Received more data ({}B) than the maximum ({}B) without the deliminator!",
+                                   data.size(), max_size };
+
+      search_pos = !delim.empty() && data.size() >= delim.size() ? data.size() - delim.size() + 1 : 0;
+
+      if (steady_clock::now() - start >= time_expire)
+        break;
+
+      // If no data block until some arrives or the remaining time expire
+      if (!this->fill())
+        m_sock.wait_readable(remaining_time(start, time_expire));
+    }
+
+    throw socket_timeout { "Wait time ({}) expired while especting the deliminator! Buffered {} bytes!",
+                            time_expire, this->buffered() };
+  }
+
+  template <class S>
+  template <class R, class P>
+  vector<byte> stream_reader<S>::read_exact(size_t exact_size, duration<R, P> time_expire)
+  {
+    vector<byte> ret(exact_size);
+    this->read_exact(span { ret }, time_expire);
+
+    return ret;
+  }
+
+  template <class S>
+  template <class R, class P>
+  void stream_reader<S>::read_exact(span<byte> buffer, duration<R, P> time_expire)
+  {
+    // First the buffered data
+    const auto qtde = min(buffer.size(), this->buffered());
+    rng::copy(this->buffered_data().first(qtde), buffer.begin());
+    this->consume(qtde);
+
+    // Then the connection, never reads past the buffer so nothing to keep
+    if (qtde < buffer.size())
+      receive_until_size(m_sock, buffer.subspan(qtde), time_expire);
+  }
+
+  // Template class instanciation
+  template class stream_reader<socket>;
+  template class stream_reader<tls_socket>;
+
+  // Function template instanciation
+  template vector<byte> stream_reader<socket>::read_until(span<const byte>, seconds, size_t);
+  template vector<byte> stream_reader<socket>::read_until(span<const byte>, milliseconds, size_t);
+  template vector<byte> stream_reader<socket>::read_exact(size_t, seconds);
+  template vector<byte> stream_reader<socket>::read_exact(size_t, milliseconds);
+  template void stream_reader<socket>::read_exact(span<byte>, seconds);
+  template void stream_reader<socket>::read_exact(span<byte>, milliseconds);
+
+  template vector<byte> stream_reader<tls_socket>::read_until(span<const byte>, seconds, size_t);
+  template vector<byte> stream_reader<tls_socket>::read_until(span<const byte>, milliseconds, size_t);
+  template vector<byte> stream_reader<tls_socket>::read_exact(size_t, seconds);
+  template vector<byte> stream_reader<tls_socket>::read_exact(size_t, milliseconds);
+  template void stream_reader<tls_socket>::read_exact(span<byte>, seconds);
+  template void stream_reader<tls_socket>::read_exact(span<byte>, milliseconds);
+}
@@ -0,0 +1,123 @@
+#include "tls_context.h"
+
+#include <mutex>
+#include <utility>
+#include <openssl/ssl.h>
+#include "cfg.h"
+#include "nes_exc.h"
+using namespace std;
+
+namespace nes::net {
+
+  // Init flag (definied in tls_socket)
+  extern once_flag init_lib;
+  void initialize_OpenSSL();
+
+  // Session resumption callbacks (definied in tls_socket and tls_socket_serv)
+  void client_session_setup(SSL_CTX*);
+  void server_session_setup(SSL_CTX*);
+
+  tls_context::tls_context(role r)
+    : m_role { r }
+  {
+    call_once(init_lib, initialize_OpenSSL);
+
+    m_ctx = SSL_CTX_new(r == role::client ? TLS_client_method() : TLS_server_method());
+    if (!m_ctx)
+      throw nes_exc { "Fail to alocate the OpenSSL context." };
+
+    // A write retry after a timeout can come from another buffer address
+    // and the writes return each record sent (not only the whole buffer)
+    SSL_CTX_set_mode(m_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+    // Read ahead, the socket is read in big blocks and not record by record
+    SSL_CTX_set_read_ahead(m_ctx, 1);
+    SSL_CTX_set_default_read_buffer_len(m_ctx, cfg::net::tls_read_ahead_size);
+
+    if (r == role::client)
+      client_session_setup(m_ctx);
+    else
+      server_session_setup(m_ctx);
+  }
+
+  tls_context::~tls_context()
+  {
+    if (m_ctx)
+      SSL_CTX_free(m_ctx);
+  }
+
+  tls_context::tls_context(const tls_context& other)
+    : m_ctx { other.m_ctx }
+    , m_role { other.m_role }
+  {
+    if (m_ctx)
+      SSL_CTX_up_ref(m_ctx);
+  }
+
+  tls_context::tls_context(tls_context&& other)
+    : m_ctx { exchange(other.m_ctx, nullptr) }
+    , m_role { other.m_role }
+  {
+
+  }
+
+  tls_context& tls_context::operator=(const tls_context& other)
+  {
+    if (other.m_ctx)
+      SSL_CTX_up_ref(other.m_ctx);
+    if (m_ctx)
+      SSL_CTX_free(m_ctx);
+
+    m_ctx = other.m_ctx;
+    m_role = other.m_role;
+
+    return *this;
+  }
+
+  tls_context& tls_context::operator=(tls_context&& other)
+  {
+    swap(m_ctx, other.m_ctx);
+    swap(m_role, other.m_role);
+
+    return *this;
+  }
+
+  tls_context::role tls_context::context_role() const
+  {
+    return m_role;
+  }
+
+  SSL_CTX* tls_context::native_handle() const
+  {
+    return m_ctx;
+  }
+
+  void tls_context::use_certificate(const string& pubkey_path, const string& privkey_path)
+  {
+    if (!m_ctx || m_role != role::server)
+      throw nes_exc { "The certificate is of a server context." };
+
+    // TLS Certificates configuration
+    if(SSL_CTX_use_certificate_file(m_ctx, pubkey_path.c_str(), SSL_FILETYPE_PEM) <= 0)
+      throw nes_exc { "Public Key configuration error." };
+
+    if(SSL_CTX_use_PrivateKey_file(m_ctx, privkey_path.c_str(), SSL_FILETYPE_PEM) <= 0)
+      throw nes_exc { "Private Key configuration error." };
+
+    if (!SSL_CTX_check_private_key(m_ctx))
+      throw nes_exc { "Public/Private configuration mismatch." };
+  }
+
+  const tls_context& tls_context::client()
+  {
+    static const tls_context ctx { role::client };
+    return ctx;
+  }
+
+  const tls_context& tls_context::thread_client()
+  {
+    thread_local const tls_context ctx { role::client };
+    return ctx;
+  }
+
+}
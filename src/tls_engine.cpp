@@ -0,0 +1,199 @@
+#include "tls_engine.h"
+
+#include <utility>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include "nes_exc.h"
+using namespace std;
+
+namespace nes::net {
+
+  tls_engine::tls_engine(const tls_context& ctx, size_t buffer_size)
+  {
+    m_ssl = SSL_new(ctx.native_handle());
+    if (!m_ssl)
+      throw nes_exc { "Not possible alocate the OpenSSL engine context." };
+
+    // SSL side of the pair owned by the handle
+    BIO *ssl_bio { nullptr };
+    if (BIO_new_bio_pair(&ssl_bio, buffer_size, &m_net_bio, buffer_size) != 1)
+    {
+      SSL_free(m_ssl);
+      throw nes_exc { "Not possible alocate the engine BIO pair." };
+    }
+    SSL_set_bio(m_ssl, ssl_bio, ssl_bio);
+
+    if (ctx.context_role() == tls_context::role::client)
+      SSL_set_connect_state(m_ssl);
+    else
+      SSL_set_accept_state(m_ssl);
+  }
+
+  tls_engine::~tls_engine()
+  {
+    if (m_ssl)
+      SSL_free(m_ssl);
+    if (m_net_bio)
+      BIO_free(m_net_bio);
+  }
+
+  tls_engine::tls_engine(tls_engine&& other)
+    : m_ssl { exchange(other.m_ssl, nullptr) }
+    , m_net_bio { exchange(other.m_net_bio, nullptr) }
+    , m_handshake_done { other.m_handshake_done }
+    , m_closed { other.m_closed }
+  {
+
+  }
+
+  tls_engine& tls_engine::operator=(tls_engine&& other)
+  {
+    swap(m_ssl, other.m_ssl);
+    swap(m_net_bio, other.m_net_bio);
+    swap(m_handshake_done, other.m_handshake_done);
+    swap(m_closed, other.m_closed);
+
+    return *this;
+  }
+
+  void tls_engine::check_error(int ret, const char* operation)
+  {
+    auto errcode = SSL_get_error(m_ssl, ret);
+    switch (errcode)
+    {
+      case SSL_ERROR_WANT_READ:
+      case SSL_ERROR_WANT_WRITE:
+        return;
+
+      case SSL_ERROR_ZERO_RETURN:
+        m_closed = true;
+        return;
+
+      default:
+      {
+        string msg = "Error on TLS engine " + string { operation } + "! Cod.: " + to_string(errcode);
+
+        // Collect all the errors and create the error message
+        while (auto err = ERR_get_error())
+          msg += string { "\n" } + ERR_error_string(err, NULL);
+
+        throw nes_exc { msg };
+      }
+    }
+  }
+
+  void tls_engine::tls_ext_host_name(const string& host)
+  {
+    SSL_set_tlsext_host_name(m_ssl, host.c_str());
+  }
+
+  bool tls_engine::handshake()
+  {
+    if (m_handshake_done)
+      return true;
+
+    int ret = SSL_do_handshake(m_ssl);
+    if (ret == 1)
+      m_handshake_done = true;
+    else
+      this->check_error(ret, "handshake");
+
+    return m_handshake_done;
+  }
+
+  bool tls_engine::handshake_done() const
+  {
+    return m_handshake_done;
+  }
+
+  bool tls_engine::is_closed() const
+  {
+    return m_closed;
+  }
+
+  size_t tls_engine::feed(span<const std::byte> data)
+  {
+    size_t qtde = 0;
+    if (data.empty() || BIO_write_ex(m_net_bio, data.data(), data.size(), &qtde) != 1)
+      return 0;
+
+    return qtde;
+  }
+
+  size_t tls_engine::output_size() const
+  {
+    return BIO_ctrl_pending(m_net_bio);
+  }
+
+  size_t tls_engine::take_output(span<std::byte> buffer)
+  {
+    size_t qtde = 0;
+    if (buffer.empty() || BIO_read_ex(m_net_bio, buffer.data(), buffer.size(), &qtde) != 1)
+      return 0;
+
+    return qtde;
+  }
+
+  vector<std::byte> tls_engine::take_output()
+  {
+    vector<std::byte> ret(this->output_size());
+    ret.resize(this->take_output(ret));
+
+    return ret;
+  }
+
+  size_t tls_engine::write(span<const std::byte> data)
+  {
+    // Implicit handshake (no-op when over)
+    if (!this->handshake() || data.empty())
+      return 0;
+
+    size_t qtde = 0;
+    int ret = SSL_write_ex(m_ssl, data.data(), data.size(), &qtde);
+    if (ret != 1)
+      this->check_error(ret, "write");
+
+    return qtde;
+  }
+
+  size_t tls_engine::read(span<std::byte> buffer)
+  {
+    if (!this->handshake() || buffer.empty())
+      return 0;
+
+    size_t qtde = 0;
+    int ret = SSL_read_ex(m_ssl, buffer.data(), buffer.size(), &qtde);
+    if (ret != 1)
+      this->check_error(ret, "read");
+
+    return qtde;
+  }
+
+  size_t tls_engine::pending() const
+  {
+    return static_cast<size_t>(SSL_pending(m_ssl));
+  }
+
+  void tls_engine::shutdown()
+  {
+    SSL_shutdown(m_ssl);
+  }
+
+  string tls_engine::cipher() const
+  {
+    if (m_ssl)
+      return string { SSL_get_cipher(m_ssl) };
+    else
+      return string {};
+  }
+
+  string tls_engine::tls_protocol() const
+  {
+    if (m_ssl)
+      return string { SSL_get_version(m_ssl) };
+    else
+      return string {};
+  }
+
+}
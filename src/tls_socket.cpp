@@ -1,29 +1,39 @@
 #include "tls_socket.h"
 
-#include <atomic>
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <limits>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <openssl/bio.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "cfg.h"
 #include "nes_exc.h"
+#include "net_exc.h"
 #include "socket_util.h"
 using namespace std;
 using namespace std::chrono;
 using namespace std::chrono_literals;
+namespace rng = std::ranges;
 using namespace nes;
 
 namespace nes::net {
 
-  // Init/Destroy flag
+  // Init flag
   once_flag init_lib;
   void initialize_OpenSSL();
 
-  SSL_CTX *openssl_ctx();
-  void openssl_ctx_free();
-
   // Aux RAII temporary handle
   namespace {
     class sockssl_rai final
@@ -40,23 +50,145 @@ namespace nes::net {
       SSL* release() { SSL *ret = m_sock_ssl; m_sock_ssl = nullptr; return ret; };
     };
 
-    class ctxssl_ini final
+    // Client sessions by host:port/SNI, filled by the new session callback (TLS 1.3 tickets arrive after
+    // the handshake) and used in the next connect to the same key
+    class client_session_cache final
     {
-      bool m_is_init { false };
+      mutex m_mtx;
+      unordered_map<string, SSL_SESSION*> m_sessions;
+      deque<string> m_order;
+
     public:
-      ctxssl_ini() { openssl_ctx(); }
+      ~client_session_cache() { this->clear(); };
+
+      // New reference to the cached session (nullptr if none)
+      SSL_SESSION* find(const string& key)
+      {
+        lock_guard lck { m_mtx };
+        auto it = m_sessions.find(key);
+        if (it == m_sessions.end() || !SSL_SESSION_up_ref(it->second))
+          return nullptr;
+
+        return it->second;
+      }
 
-      ~ctxssl_ini() { if (!m_is_init) openssl_ctx_free(); }
+      // Take the session reference
+      void store(const string& key, SSL_SESSION* session)
+      {
+        lock_guard lck { m_mtx };
+        if (auto [it, ins] = m_sessions.try_emplace(key, session); !ins)
+        {
+          SSL_SESSION_free(it->second);
+          it->second = session;
+          return;
+        }
+        m_order.push_back(key);
 
-      void set_initialized() { m_is_init = true; };
+        // Oldest entries out
+        while (m_sessions.size() > cfg::net::tls_client_session_cache_size)
+        {
+          auto old = m_sessions.find(m_order.front());
+          SSL_SESSION_free(old->second);
+          m_sessions.erase(old);
+          m_order.pop_front();
+        }
+      }
+
+      void clear()
+      {
+        lock_guard lck { m_mtx };
+        for (auto& [key, session] : m_sessions)
+          SSL_SESSION_free(session);
+        m_sessions.clear();
+        m_order.clear();
+      }
     };
+
+    // Created after the OpenSSL init, so it is destroyed before the OpenSSL exit cleanup
+    client_session_cache& client_sessions()
+    {
+      static client_session_cache cache;
+      return cache;
+    }
+
+    // Cache key of the client SSL handle (SSL ex data, freed with the handle)
+    int session_key_index()
+    {
+      static const int idx = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr,
+        [] (void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) { delete static_cast<string*>(ptr); });
+
+      return idx;
+    }
+
+    void set_session_key(SSL* ssl, string key)
+    {
+      // Resume the cached session of the key, or a full handshake
+      SSL_SESSION* session = client_sessions().find(key);
+      SSL_set_session(ssl, session);
+      if (session)
+        SSL_SESSION_free(session);
+
+      delete static_cast<string*>(SSL_get_ex_data(ssl, session_key_index()));
+      SSL_set_ex_data(ssl, session_key_index(), new string { move(key) });
+    }
+
+    int new_session_callback(SSL* ssl, SSL_SESSION* session)
+    {
+      // Server side and not resumable sessions are not cached
+      auto key = static_cast<const string*>(SSL_get_ex_data(ssl, session_key_index()));
+      if (!key || !SSL_SESSION_is_resumable(session))
+        return 0;
+
+      client_sessions().store(*key, session);
+      return 1;
+    }
+
+    // Send the close_notify alert, the peer could have closed (no SIGPIPE)
+    void shutdown_ssl(SSL* ssl)
+    {
+      #ifndef _WIN32
+      sigset_t pipe_set, old_set;
+      sigemptyset(&pipe_set);
+      sigaddset(&pipe_set, SIGPIPE);
+      pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+      SSL_shutdown(ssl);
+
+      // Discard the SIGPIPE raised by the shutdown (if not pending before)
+      if (!sigismember(&old_set, SIGPIPE))
+      {
+        sigset_t pending;
+        sigpending(&pending);
+        if (sigismember(&pending, SIGPIPE))
+        {
+          const timespec no_wait {};
+          sigtimedwait(&pipe_set, nullptr, &no_wait);
+        }
+      }
+      pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+      #else
+      SSL_shutdown(ssl);
+      #endif
+    }
+
+    #ifndef _WIN32
+    class fd_rai final
+    {
+      int m_fd;
+    public:
+      fd_rai(int fd) : m_fd { fd } {};
+      ~fd_rai() { if (m_fd >= 0) close(m_fd); };
+
+      fd_rai(const fd_rai&) = delete;
+
+      int handle() const { return m_fd; };
+    };
+    #endif
   }
 
   tls_socket::tls_socket()
   {
     call_once(init_lib, initialize_OpenSSL);
-
-    openssl_ctx();
   }
 
   tls_socket::tls_socket(SSL* ssl, socket s)
@@ -64,27 +196,31 @@ namespace nes::net {
     , m_sock_ssl { ssl }
     , m_handshake { handshake_state::accept }
   {
-    openssl_ctx();
+
   }
 
   tls_socket::tls_socket(string ip, unsigned port)
+    : tls_socket { move(ip), port, tls_context::client() }
   {
-    call_once(init_lib, initialize_OpenSSL);
-
-    ctxssl_ini ini;
 
-    this->connect(ip, port);
+  }
 
-    ini.set_initialized();
+  tls_socket::tls_socket(string ip, unsigned port, const tls_context& ctx)
+  {
+    this->connect(move(ip), port, ctx);
   }
 
   tls_socket::tls_socket(tls_socket&& other)
     : m_sock { move(other.m_sock) }
     , m_sock_ssl { other.m_sock_ssl }
+    , m_host { move(other.m_host) }
+    , m_send_queue { move(other.m_send_queue) }
     , m_handshake { other.m_handshake }
+    , m_dynamic_records { other.m_dynamic_records }
+    , m_record_bytes { other.m_record_bytes }
+    , m_last_write { other.m_last_write }
+    , m_write_retry { other.m_write_retry }
   {
-    openssl_ctx();
-
     other.m_sock_ssl = nullptr;
   }
 
@@ -92,7 +228,13 @@ namespace nes::net {
   {
     swap(m_sock, other.m_sock);
     swap(m_sock_ssl, other.m_sock_ssl);
+    swap(m_host, other.m_host);
+    swap(m_send_queue, other.m_send_queue);
     swap(m_handshake, other.m_handshake);
+    swap(m_dynamic_records, other.m_dynamic_records);
+    swap(m_record_bytes, other.m_record_bytes);
+    swap(m_last_write, other.m_last_write);
+    swap(m_write_retry, other.m_write_retry);
 
     return *this;
   }
@@ -100,20 +242,27 @@ namespace nes::net {
   tls_socket::~tls_socket()
   {
     this->disconnect();
-
-    openssl_ctx_free();
   }
 
   void tls_socket::connect(string addr, unsigned port)
+  {
+    this->connect(move(addr), port, tls_context::client());
+  }
+
+  void tls_socket::connect(string addr, unsigned port, const tls_context& ctx)
   {
     if (m_sock_ssl)
       throw nes_exc { "TLS-Socket already configured." };
 
+    if (ctx.context_role() != tls_context::role::client)
+      throw nes_exc { "The TLS connect needs a client context." };
+
     // First create the native socket, the tls protocol is layered
+    string host = addr;
     socket s(move(addr), port);
 
-    // OpenSSL handler
-    SSL *sock_ssl = SSL_new(openssl_ctx());
+    // OpenSSL handler (holds a context reference)
+    SSL *sock_ssl = SSL_new(ctx.native_handle());
     if (!sock_ssl)
       throw nes_exc { "Not possible alocate the OpenSSL client context." };
     sockssl_rai ssock_ssl(sock_ssl);
@@ -123,15 +272,23 @@ namespace nes::net {
     if (ret != 1)
       throw nes_exc { "Can not bind the SSL handle with native socket." };
 
+    // Session of a previous connection
+    set_session_key(ssock_ssl.handle(), format("{}:{}", host, port));
+
     // All ok, can set the class
     m_sock_ssl = ssock_ssl.release();
     m_sock = move(s);
+    m_host = move(host);
   }
 
   void tls_socket::disconnect()
   {
     if (m_sock_ssl)
     {
+      // Orderly close, the session stays resumable
+      if (m_handshake == handshake_state::ok)
+        shutdown_ssl(m_sock_ssl);
+
       SSL_free(m_sock_ssl);
       m_sock_ssl = nullptr;
 
@@ -142,71 +299,102 @@ namespace nes::net {
 
   void tls_socket::handshake()
   {
-    milliseconds interval = cfg::net::wait_io_step_min;
-    size_t retry_count = 0;
+    const auto time_expire = steady_clock::now() + cfg::net::tls_handshake_timeout;
+
+    // Wait the socket for the next step
+    for (auto status = this->handshake_step(); status != handshake_status::done; status = this->handshake_step())
+    {
+      const auto now = steady_clock::now();
+      if (now >= time_expire)
+        throw nes_exc { "Handshake timeout." };
+
+      const auto remaining = ceil<milliseconds>(time_expire - now);
+      if (status == handshake_status::want_read)
+        m_sock.wait_readable(remaining);
+      else
+        m_sock.wait_writable(remaining);
+    }
+  }
+
+  tls_socket::handshake_status tls_socket::handshake_step()
+  {
+    if (!m_sock_ssl)
+      throw nes_exc { "The TLS socket is not connected." };
 
-    // Handshake process
     int ret = -1;
-    do {
-      switch (m_handshake)
-      {
-        case handshake_state::connect:
-          ret = SSL_connect(m_sock_ssl);
-          break;
+    switch (m_handshake)
+    {
+      case handshake_state::connect:
+        ret = SSL_connect(m_sock_ssl);
+        break;
 
-        case handshake_state::accept:
-          ret = SSL_accept(m_sock_ssl);
-          break;
+      case handshake_state::accept:
+        ret = SSL_accept(m_sock_ssl);
+        break;
 
-        case handshake_state::ok:
-          throw nes_exc { "Handshake already over." };
-      }
+      case handshake_state::ok:
+        return handshake_status::done;
+    }
 
-      if (ret == 0)
-        throw nes_exc { "Handshake error." };
-      else if (ret == -1)
+    if (ret == 1)
+    {
+      m_handshake = handshake_state::ok;
+      return handshake_status::done;
+    }
+
+    auto errcode = SSL_get_error(m_sock_ssl, ret);
+    switch(errcode)
+    {
+      case SSL_ERROR_WANT_READ:
+        return handshake_status::want_read;
+
+      case SSL_ERROR_WANT_WRITE:
+        return handshake_status::want_write;
+
+      default:
       {
-        auto errcode = SSL_get_error(m_sock_ssl, -1);
-        switch(errcode)
-        {
-          case SSL_ERROR_WANT_READ:
-          case SSL_ERROR_WANT_WRITE:
-          {
-            this_thread::sleep_for(interval);
-
-            if (retry_count >= cfg::net::io_max_retry)
-              throw nes_exc { "Handshake timeout." };
-
-            interval = calculate_interval_retry(++retry_count);
-            break;
-          }
-          default:
-          {
-            vector<decltype(errcode)> errors;
-            string msg = "Error while making the handshake!\n";
-            errors.push_back(errcode);
-
-            // Collect all the errors and create the error message
-            while ((errcode = static_cast<decltype(errcode)>(ERR_get_error())) != 0)
-            errors.push_back(errcode);
-
-            for (const auto erro : errors)
-              msg += to_string(erro) + " " + ERR_error_string(static_cast<unsigned long>(erro), NULL);
-
-            throw nes_exc { msg };
-          }
-        }
+        vector<decltype(errcode)> errors;
+        string msg = "Error while making the handshake!\n";
+        errors.push_back(errcode);
+
+        // Collect all the errors and create the error message
+        while ((errcode = static_cast<decltype(errcode)>(ERR_get_error())) != 0)
+          errors.push_back(errcode);
+
+        for (const auto erro : errors)
+          msg += to_string(erro) + " " + ERR_error_string(static_cast<unsigned long>(erro), NULL);
+
+        throw nes_exc { msg };
       }
-    } while (ret != 1);
+    }
+  }
 
-    m_handshake = handshake_state::ok;
+  bool tls_socket::handshake_done() const
+  {
+    return m_sock_ssl && m_handshake == handshake_state::ok;
   }
 
   void tls_socket::tls_ext_host_name(string host)
   {
     // Special TLS Protocol extensions
     if (m_sock_ssl)
+    {
       SSL_ctrl(m_sock_ssl, SSL_CTRL_SET_TLSEXT_HOSTNAME, TLSEXT_NAMETYPE_host_name, host.data());
+
+      // The session is of the virtual host
+      if (m_handshake == handshake_state::connect)
+        set_session_key(m_sock_ssl, format("{}:{}/{}", m_host, m_sock.ipv4_port(), host));
+    }
+  }
+
+  bool tls_socket::session_reused() const
+  {
+    return m_sock_ssl && SSL_session_reused(m_sock_ssl);
+  }
+
+  void tls_socket::clear_session_cache()
+  {
+    client_sessions().clear();
   }
 
   const string& tls_socket::ipv4_address() const
@@ -224,6 +412,11 @@ namespace nes::net {
     return m_sock_ssl != nullptr;
   }
 
+  tls_socket::native_handle_type tls_socket::native_handle() const
+  {
+    return m_sock.native_handle();
+  }
+
   string tls_socket::cipher() const
   {
     if (m_sock_ssl)
@@ -240,7 +433,90 @@ namespace nes::net {
       return string {};
   }
 
+  bool tls_socket::enable_ktls()
+  {
+    // The kernel gets the keys at the end of the handshake
+    if (!m_sock_ssl || m_handshake == handshake_state::ok)
+      return false;
+
+    #ifdef OPENSSL_NO_KTLS
+    return false;
+    #else
+    SSL_set_options(m_sock_ssl, SSL_OP_ENABLE_KTLS);
+    return true;
+    #endif
+  }
+
+  bool tls_socket::ktls_send() const
+  {
+    return m_sock_ssl && BIO_get_ktls_send(SSL_get_wbio(m_sock_ssl));
+  }
+
+  bool tls_socket::ktls_receive() const
+  {
+    return m_sock_ssl && BIO_get_ktls_recv(SSL_get_rbio(m_sock_ssl));
+  }
+
+  void tls_socket::set_dynamic_records(bool enable)
+  {
+    m_dynamic_records = enable;
+  }
+
+  size_t tls_socket::record_size() const
+  {
+    if (!m_dynamic_records)
+      return cfg::net::tls_record_size;
+
+    // Idle connection starts again with small records (congestion window restarted)
+    const bool idle = steady_clock::now() - m_last_write >= cfg::net::tls_dynamic_record_idle;
+    return idle || m_record_bytes < cfg::net::tls_dynamic_record_threshold ? cfg::net::tls_small_record_size
+                                                                           : cfg::net::tls_record_size;
+  }
+
   void tls_socket::send(span<const std::byte> data_span)
+  {
+    // Gives up only if no progress at all in the wait time
+    while (data_span.size())
+    {
+      auto sent = this->send(data_span, cfg::net::wait_io_send_max);
+      if (!sent)
+        throw socket_timeout { "Wait time ({}) expired while sending data! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, data_span.size() };
+
+      data_span = data_span.subspan(sent);
+    }
+  }
+
+  size_t tls_socket::send(span<const std::byte> data_span, milliseconds time_expire)
+  {
+    return this->send_gather(span { &data_span, 1 }, 0, time_expire);
+  }
+
+  void tls_socket::send(span<const span<const std::byte>> buffers)
+  {
+    size_t total_size = 0;
+    for (const auto& buffer : buffers)
+      total_size += buffer.size();
+
+    // Gives up only if no progress at all in the wait time
+    size_t sent_total = 0;
+    while (sent_total < total_size)
+    {
+      auto sent = this->send_gather(buffers, sent_total, cfg::net::wait_io_send_max);
+      if (!sent)
+        throw socket_timeout { "Wait time ({}) expired while sending data! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, total_size - sent_total };
+
+      sent_total += sent;
+    }
+  }
+
+  size_t tls_socket::send(span<const span<const std::byte>> buffers, milliseconds time_expire)
+  {
+    return this->send_gather(buffers, 0, time_expire);
+  }
+
+  size_t tls_socket::send_gather(span<const span<const std::byte>> buffers, size_t offset, milliseconds time_expire)
   {
     if (!m_sock.is_connected())
       throw nes_exc { "The TLS socket is not connected." };
@@ -248,38 +524,83 @@ namespace nes::net {
     if (m_handshake != handshake_state::ok)
       this->handshake();
 
-    milliseconds interval = cfg::net::wait_io_step_min;
-    size_t retry_count = 0;
-    int ret;
-    do {
-      ret = SSL_write(m_sock_ssl, data_span.data(), static_cast<int>(data_span.size()));
-      if (ret > 0)
-      {
-        if (static_cast<size_t>(ret) != data_span.size())
-          throw nes_exc { "Can not send all the data." };
-      }
+    // Current position, the buffer index and the offset inside it
+    size_t idx = 0;
+    while (idx < buffers.size() && offset >= buffers[idx].size())
+      offset -= buffers[idx++].size();
+
+    // Write in full records (of record_size()), a retry after WANT_* repeats at least the same record
+    const auto start = steady_clock::now();
+    array<std::byte, cfg::net::tls_record_size> record;
+    size_t sent = 0;
+    while (idx < buffers.size())
+    {
+      const auto limit = max(this->record_size(), m_write_retry);
+
+      // Straight from the buffer when it fills a record (or is the last), small buffers are coalesced
+      auto chunk = buffers[idx].subspan(offset);
+      if (chunk.size() >= limit || idx + 1 == buffers.size())
+        chunk = chunk.first(min(chunk.size(), limit));
       else
       {
-        auto coderr = SSL_get_error(m_sock_ssl, ret);
-        switch(coderr)
+        size_t record_size = 0;
+        for (auto i = idx; i < buffers.size() && record_size < limit; ++i)
         {
-          case SSL_ERROR_WANT_READ:
-          case SSL_ERROR_WANT_WRITE:
-          {
-            this_thread::sleep_for(interval);
+          auto part = buffers[i].subspan(i == idx ? offset : 0);
+          part = part.first(min(part.size(), limit - record_size));
+          rng::copy(part, record.begin() + static_cast<ptrdiff_t>(record_size));
+          record_size += part.size();
+        }
+        chunk = span { record }.first(record_size);
+      }
 
-            if (retry_count >= cfg::net::io_max_retry)
-              throw nes_exc { "Timeout sending data." };
+      // Only empty buffers remaining
+      if (chunk.empty())
+        break;
 
-            interval = calculate_interval_retry(++retry_count);
+      int ret = SSL_write(m_sock_ssl, chunk.data(), static_cast<int>(chunk.size()));
+      if (ret > 0)
+      {
+        // Bytes of the dynamic record size, counted again after idle
+        const auto now = steady_clock::now();
+        if (now - m_last_write >= cfg::net::tls_dynamic_record_idle)
+          m_record_bytes = 0;
+        m_record_bytes += static_cast<size_t>(ret);
+        m_last_write = now;
+        m_write_retry = 0;
+
+        // Advance the position by the bytes written
+        sent += static_cast<size_t>(ret);
+        offset += static_cast<size_t>(ret);
+        while (idx < buffers.size() && offset >= buffers[idx].size())
+          offset -= buffers[idx++].size();
+        continue;
+      }
 
-            break;
-          }
-          default:
-            throw nes_exc { "Error sending data! Cod.: {}", coderr };
+      auto coderr = SSL_get_error(m_sock_ssl, ret);
+      const auto elapsed = steady_clock::now() - start;
+      switch(coderr)
+      {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+        {
+          m_write_retry = max(m_write_retry, chunk.size());
+          if (elapsed >= time_expire)
+            return sent;
+
+          // Wait the direction the TLS layer needs
+          if (coderr == SSL_ERROR_WANT_READ)
+            m_sock.wait_readable(ceil<milliseconds>(time_expire - elapsed));
+          else
+            m_sock.wait_writable(ceil<milliseconds>(time_expire - elapsed));
+          break;
         }
+        default:
+          throw nes_exc { "Error sending data! Cod.: {}", coderr };
       }
-    } while (ret <= 0);
+    }
+
+    return sent;
   }
 
   void tls_socket::send(string_view data_str)
@@ -287,7 +608,55 @@ namespace nes::net {
     this->send(as_bytes(span { data_str.begin(), data_str.end() }));
   }
 
+  size_t tls_socket::send(string_view data_str, milliseconds time_expire)
+  {
+    return this->send(as_bytes(span { data_str.begin(), data_str.end() }), time_expire);
+  }
+
   vector<std::byte> tls_socket::receive()
+  {
+    return receive_available(*this, vector<std::byte> {});
+  }
+
+  pmr::vector<std::byte> tls_socket::receive(pmr::memory_resource* mr)
+  {
+    return receive_available(*this, pmr::vector<std::byte> { mr });
+  }
+
+  shared_buffer tls_socket::receive_shared()
+  {
+    return shared_buffer { this->receive() };
+  }
+
+  void tls_socket::send(const buffer_chain& data)
+  {
+    vector<span<const std::byte>> buffers;
+    buffers.reserve(data.slices().size());
+    for (const auto& slice : data.slices())
+      buffers.push_back(slice.bytes());
+
+    this->send(span<const span<const std::byte>> { buffers });
+  }
+
+  void tls_socket::send_file(const filesystem::path& path, uint64_t offset, uint64_t length)
+  {
+    // Gives up only if no progress at all in the wait time
+    const auto file_size = filesystem::file_size(path);
+    length = offset < file_size ? min(length, file_size - offset) : 0;
+    while (length)
+    {
+      auto sent = this->send_file(path, offset, length, cfg::net::wait_io_send_max);
+      if (!sent)
+        throw socket_timeout { "Wait time ({}) expired while sending the file! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, length };
+
+      offset += sent;
+      length -= sent;
+    }
+  }
+
+  uint64_t tls_socket::send_file(const filesystem::path& path, uint64_t offset, uint64_t length,
+    milliseconds time_expire)
   {
     if (!m_sock.is_connected())
       throw nes_exc { "The TLS socket is not connected." };
@@ -295,39 +664,221 @@ namespace nes::net {
     if (m_handshake != handshake_state::ok)
       this->handshake();
 
-    array<std::byte, cfg::net::packet_size> packet_buffer;
-    vector<std::byte> ret;
+    // Truncate at the end of the file
+    const auto file_size = filesystem::file_size(path);
+    if (offset >= file_size)
+      return 0;
+    length = min(length, file_size - offset);
+
+    const auto start = steady_clock::now();
+    uint64_t sent = 0;
 
-    while (true)
+    #ifndef _WIN32
+    if (this->ktls_send())
     {
-      int res = SSL_read(m_sock_ssl, packet_buffer.data(), static_cast<int>(packet_buffer.size()));
-      if (res > 0)
-        ret.insert(ret.end(), packet_buffer.begin(), packet_buffer.begin() + static_cast<size_t>(res));
-      else
+      // The kernel encrypts the file pages, no user space copy
+      fd_rai fd { open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+      if (fd.handle() < 0)
+        throw nes_exc { "Error on open the file '{}' to send. Error {}: '{}'.", path.string(), errno, strerror(errno) };
+
+      while (sent < length)
       {
-        auto coderr = SSL_get_error(m_sock_ssl, res);
-        switch(coderr)
+        const auto chunk = static_cast<size_t>(min<uint64_t>(length - sent, numeric_limits<int>::max()));
+        auto ret = SSL_sendfile(m_sock_ssl, fd.handle(), static_cast<off_t>(offset + sent), chunk, 0);
+        if (ret > 0)
         {
-          case SSL_ERROR_WANT_READ:
-          case SSL_ERROR_WANT_WRITE:
-            break;
-          default:
-          {
-            if (ret.size())
-              break;
-
-            // Check if the underlying socket has clossed normally
-            if (coderr == SSL_ERROR_SYSCALL && ERR_get_error() == 0)
-              static_cast<void>(m_sock.receive());
-
-            throw nes_exc { "Error receiving data! Cod.: {}", coderr };
-          }
+          sent += static_cast<uint64_t>(ret);
+          continue;
         }
+
+        auto coderr = SSL_get_error(m_sock_ssl, static_cast<int>(ret));
+        const auto elapsed = steady_clock::now() - start;
+        if (coderr != SSL_ERROR_WANT_WRITE)
+          throw nes_exc { "Error sending the file! Cod.: {}", coderr };
+
+        // Socket buffer full, wait until it has room or the time expire
+        if (elapsed >= time_expire)
+          break;
+
+        m_sock.wait_writable(ceil<milliseconds>(time_expire - elapsed));
+      }
+
+      return sent;
+    }
+    #endif
+
+    // Read in records and send, a record not fully sent in the time is read again by the caller resume
+    ifstream file { path, ios::binary };
+    if (!file)
+      throw nes_exc { "Error on open the file '{}' to send.", path.string() };
+    file.seekg(static_cast<streamoff>(offset));
+
+    vector<std::byte> block(static_cast<size_t>(min<uint64_t>(length, 4 * cfg::net::tls_record_size)));
+    while (sent < length)
+    {
+      const auto to_read = static_cast<size_t>(min<uint64_t>(length - sent, block.size()));
+      file.read(reinterpret_cast<char*>(block.data()), static_cast<streamsize>(to_read));
+      const auto qtde = static_cast<size_t>(file.gcount());
+
+      // File truncated while sending
+      if (qtde == 0)
         break;
+
+      const auto elapsed = steady_clock::now() - start;
+      const auto block_sent = this->send(span { block }.first(qtde),
+        elapsed < time_expire ? ceil<milliseconds>(time_expire - elapsed) : milliseconds { 0 });
+      sent += block_sent;
+
+      if (block_sent < qtde)
+        break;
+    }
+
+    return sent;
+  }
+
+  size_t tls_socket::receive_into(span<std::byte> buffer)
+  {
+    if (!m_sock.is_connected())
+      throw nes_exc { "The TLS socket is not connected." };
+
+    if (m_handshake != handshake_state::ok)
+      this->handshake();
+
+    size_t qtde_total = 0;
+    while (qtde_total < buffer.size())
+    {
+      // Decrypted straight in the caller memory
+      size_t qtde = 0;
+      int res = SSL_read_ex(m_sock_ssl, buffer.data() + qtde_total, buffer.size() - qtde_total, &qtde);
+      if (res == 1)
+      {
+        qtde_total += qtde;
+        continue;
       }
+
+      auto coderr = SSL_get_error(m_sock_ssl, res);
+      if (coderr == SSL_ERROR_WANT_READ || coderr == SSL_ERROR_WANT_WRITE || qtde_total)
+        break;
+
+      // Check if the underlying socket has clossed normally
+      if (coderr == SSL_ERROR_SYSCALL && ERR_get_error() == 0)
+        static_cast<void>(m_sock.receive());
+
+      throw nes_exc { "Error receiving data! Cod.: {}", coderr };
+    }
+
+    return qtde_total;
+  }
+
+  size_t tls_socket::receive_into(span<const span<std::byte>> buffers)
+  {
+    // The records are decrypted in sequence, the next buffer only after the previous is full
+    size_t qtde_total = 0;
+    for (const auto& buffer : buffers)
+    {
+      size_t qtde = 0;
+      try {
+        qtde = this->receive_into(buffer);
+      } catch (...) {
+        // With data the error is left to the next receive
+        if (!qtde_total)
+          throw;
+      }
+
+      qtde_total += qtde;
+      if (qtde < buffer.size())
+        break;
+    }
+
+    return qtde_total;
+  }
+
+  void tls_socket::set_read_ahead(size_t length)
+  {
+    if (!m_sock_ssl)
+      throw nes_exc { "The TLS socket is not connected." };
+
+    SSL_set_read_ahead(m_sock_ssl, length > 0);
+    if (length > 0)
+      SSL_set_default_read_buffer_len(m_sock_ssl, length);
+  }
+
+  size_t tls_socket::pending() const
+  {
+    return m_sock_ssl ? static_cast<size_t>(SSL_pending(m_sock_ssl)) : 0;
+  }
+
+  bool tls_socket::has_pending() const
+  {
+    return m_sock_ssl && SSL_has_pending(m_sock_ssl);
+  }
+
+  bool tls_socket::wait_readable(milliseconds time_expire)
+  {
+    if (this->pending())
+      return true;
+
+    // Buffered not decrypted data, a whole record is ready but a partial one needs the socket input
+    if (this->has_pending() && m_handshake == handshake_state::ok)
+    {
+      std::byte peek_byte;
+      size_t qtde = 0;
+      int res = SSL_peek_ex(m_sock_ssl, &peek_byte, 1, &qtde);
+      if (res == 1)
+        return true;
+
+      // Other errors are ready, the receive reports them
+      auto coderr = SSL_get_error(m_sock_ssl, res);
+      ERR_clear_error();
+      if (coderr != SSL_ERROR_WANT_READ && coderr != SSL_ERROR_WANT_WRITE)
+        return true;
     }
 
-    return ret;
+    return m_sock.wait_readable(time_expire);
+  }
+
+  bool tls_socket::wait_writable(milliseconds time_expire)
+  {
+    return m_sock.wait_writable(time_expire);
+  }
+
+  bool tls_socket::enqueue_send(span<const std::byte> data)
+  {
+    return this->enqueue_send(shared_buffer::copy_of(data));
+  }
+
+  bool tls_socket::enqueue_send(shared_buffer data)
+  {
+    // Try to write right away, only the remaining waits in the queue
+    m_send_queue.push(move(data));
+    this->flush_send();
+
+    return !m_send_queue.blocked();
+  }
+
+  size_t tls_socket::flush_send()
+  {
+    return m_send_queue.flush(*this);
+  }
+
+  size_t tls_socket::send_queued() const
+  {
+    return m_send_queue.size();
+  }
+
+  bool tls_socket::send_blocked() const
+  {
+    return m_send_queue.blocked();
+  }
+
+  void tls_socket::set_send_watermarks(size_t low_watermark, size_t high_watermark)
+  {
+    m_send_queue.set_watermarks(low_watermark, high_watermark);
+  }
+
+  bool tls_socket::set_notsent_lowat(size_t qtde)
+  {
+    return m_sock.set_notsent_lowat(qtde);
   }
 
   template <class R, class P>
@@ -359,6 +910,28 @@ namespace nes::net {
     receive_remaining(*this, data, total_size, time_expire);
   }
 
+  template <class R, class P>
+  pair<size_t, size_t>
+  tls_socket::receive_until_delimiter(span<std::byte> buffer, span<const std::byte> delim, duration<R, P> time_expire)
+  {
+    using nes::net::receive_until_delimiter;
+    return receive_until_delimiter(*this, buffer, delim, time_expire);
+  }
+
+  template <class R, class P>
+  void tls_socket::receive_until_size(span<std::byte> buffer, duration<R, P> time_expire)
+  {
+    using nes::net::receive_until_size;
+    receive_until_size(*this, buffer, time_expire);
+  }
+
+  template <class R, class P>
+  size_t tls_socket::receive_at_least(span<std::byte> buffer, size_t at_least_size, duration<R, P> time_expire)
+  {
+    using nes::net::receive_at_least;
+    return receive_at_least(*this, buffer, at_least_size, time_expire);
+  }
+
   void same_thread_handshake(tls_socket& a, tls_socket& b)
   {
     // If connecting the server client and client in same thread need make manual TLS handshake
@@ -377,49 +950,21 @@ namespace nes::net {
     else
       throw nes_exc { "The state of sockets are incompatiple to perform the handshake." };
 
-    // Make the handshake
-    tls_socket* p_sock = p_serv;
-    int ret = -1;
-    do {
-      switch (p_sock->m_handshake)
-      {
-        case tls_socket::handshake_state::connect:
-          ret = SSL_connect(p_sock->m_sock_ssl);
-          break;
-
-        case tls_socket::handshake_state::accept:
-          ret = SSL_accept(p_sock->m_sock_ssl);
-          break;
-
-        case tls_socket::handshake_state::ok:
-          throw nes_exc { "Handshake already over." };
-      }
-
-      if (ret == 0)
-        throw nes_exc { "Handshake error." };
-      else if (ret == -1)
-      {
-        auto errcode = SSL_get_error(p_sock->m_sock_ssl, -1);
-        switch(errcode)
-        {
-          case SSL_ERROR_WANT_READ:
-          case SSL_ERROR_WANT_WRITE:
-          {
-            // Troca-se os atores
-            if (p_sock == p_serv)
-              p_sock = p_cli;
-            else
-              p_sock = p_serv;
-            break;
-          }
-          default:
-            throw nes_exc { "Error making the handshake. Cod.: " + to_string(errcode) };
-        }
-      }
-    } while (ret != 1);
-
-    p_cli->m_handshake = tls_socket::handshake_state::ok;
-    p_serv->m_handshake = tls_socket::handshake_state::ok;
+    // Alternate the steps until both sides are over
+    const auto time_expire = steady_clock::now() + cfg::net::tls_handshake_timeout;
+    auto serv_status = p_serv->handshake_step();
+    auto cli_status = p_cli->handshake_step();
+    while (serv_status != tls_socket::handshake_status::done || cli_status != tls_socket::handshake_status::done)
+    {
+      if (steady_clock::now() >= time_expire)
+        throw nes_exc { "Handshake timeout." };
+
+      this_thread::yield();
+      if (cli_status != tls_socket::handshake_status::done)
+        cli_status = p_cli->handshake_step();
+      if (serv_status != tls_socket::handshake_status::done)
+        serv_status = p_serv->handshake_step();
+    }
   }
 
   void initialize_OpenSSL()
@@ -429,28 +974,11 @@ namespace nes::net {
     SSL_library_init();
   }
 
-  static atomic<unsigned> openssl_ctx_counter { 0 };
-  static SSL_CTX *openssl_ctxe { nullptr };
-
-  SSL_CTX *openssl_ctx()
-  {
-    if (openssl_ctx_counter++ == 0)
-    {
-      openssl_ctxe = SSL_CTX_new(TLS_method());
-      if (!openssl_ctxe)
-      {
-        --openssl_ctx_counter;
-        throw nes_exc { "Fail to alocate global OpenSSL context." };
-      }
-    }
-
-    return openssl_ctxe;
-  }
-
-  void openssl_ctx_free()
+  void client_session_setup(SSL_CTX* ctx)
   {
-    if (!--openssl_ctx_counter)
-      SSL_CTX_free(openssl_ctxe);
+    // Client sessions only to the resumption cache (shared by all the client contexts)
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, new_session_callback);
   }
 
   // Template instantiations (at end to work with gcc and clang)
@@ -463,5 +991,12 @@ namespace nes::net {
   template vector<std::byte> tls_socket::receive_until_size(size_t, milliseconds);
   template vector<std::byte> tls_socket::receive_at_least(size_t, seconds);
   template void tls_socket::receive_remaining(vector<std::byte>&, size_t, seconds);
+  template pair<size_t, size_t> tls_socket::receive_until_delimiter(span<std::byte>, span<const std::byte>, seconds);
+  template pair<size_t, size_t>
+  tls_socket::receive_until_delimiter(span<std::byte>, span<const std::byte>, milliseconds);
+  template void tls_socket::receive_until_size(span<std::byte>, seconds);
+  template void tls_socket::receive_until_size(span<std::byte>, milliseconds);
+  template size_t tls_socket::receive_at_least(span<std::byte>, size_t, seconds);
+  template size_t tls_socket::receive_at_least(span<std::byte>, size_t, milliseconds);
 
 }
@@ -2,25 +2,26 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <mutex>
 #include <thread>
+#include <vector>
 #include <openssl/bio.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include "nes_exc.h"
 using namespace std;
+using namespace std::chrono;
 using namespace std::chrono_literals;
 using namespace nes;
 
 namespace nes::net {
 
-  // Init/Destroy flag (definied in tls_socket)
-  extern once_flag init_lib;
-  void initialize_OpenSSL();
-
-  SSL_CTX *openssl_ctx();
-  void openssl_ctx_free();
-
   // Aux RAII temporary handle
   namespace {
     class sockssl_rai final
@@ -36,70 +37,250 @@ namespace nes::net {
       SSL* handle() { return m_sock_ssl; };
       SSL* release() { SSL *ret = m_sock_ssl; m_sock_ssl = nullptr; return ret; };
     };
+  }
+
+  struct tls_session_counters
+  {
+    atomic<uint64_t> hits { 0 };
+    atomic<uint64_t> misses { 0 };
+  };
+
+  // Session resumption of the accepted handles
+  namespace {
+    struct accepted_session
+    {
+      shared_ptr<tls_ticket_keys> keys;
+      shared_ptr<tls_session_counters> counters;
+      bool counted { false };
+    };
 
-    class ctxssl_ini final
+    // Listener data of the accepted SSL handle (SSL ex data, freed with the handle)
+    int accepted_session_index()
     {
-      bool m_is_init { false };
-    public:
-      ctxssl_ini() { openssl_ctx(); }
+      static const int idx = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr,
+        [] (void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) { delete static_cast<accepted_session*>(ptr); });
 
-      ~ctxssl_ini() { if (!m_is_init) openssl_ctx_free(); }
+      return idx;
+    }
 
-      void set_initialized() { m_is_init = true; };
-    };
+    int ticket_key_callback(SSL* ssl, unsigned char key_name[16], unsigned char* iv, EVP_CIPHER_CTX* cipher_ctx,
+      EVP_MAC_CTX* hmac_ctx, int enc)
+    {
+      // Handles not of a listener (tls_engine) have no ticket keys, no ticket and full handshakes
+      auto session = static_cast<accepted_session*>(SSL_get_ex_data(ssl, accepted_session_index()));
+      if (!session)
+        return 0;
+
+      auto set_keys = [&] (const tls_ticket_keys::key& k, bool encrypt) {
+        OSSL_PARAM params[] {
+          OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, const_cast<unsigned char*>(k.hmac_key.data()),
+            k.hmac_key.size()),
+          OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("sha256"), 0),
+          OSSL_PARAM_construct_end()
+        };
+        if (!EVP_MAC_CTX_set_params(hmac_ctx, params))
+          return false;
+
+        return (encrypt ? EVP_EncryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr, k.aes_key.data(), iv)
+                        : EVP_DecryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr, k.aes_key.data(), iv)) == 1;
+      };
+
+      // New ticket with the current key
+      if (enc)
+      {
+        const auto k = session->keys->current();
+        if (RAND_bytes(iv, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) != 1)
+          return -1;
+
+        memcpy(key_name, k.name.data(), k.name.size());
+        return set_keys(k, true) ? 1 : -1;
+      }
+
+      // Unknown key (dropped or of other listener) is a full handshake, old key renews the ticket
+      // TLS 1.3 tickets are single use in the client, always renewed
+      auto k = session->keys->find(span<const unsigned char, 16> { key_name, 16 });
+      if (!k)
+        return 0;
+
+      if (!set_keys(k->first, false))
+        return -1;
+
+      return k->second && SSL_version(ssl) < TLS1_3_VERSION ? 1 : 2;
+    }
+
+    void handshake_info_callback(const SSL* ssl, int where, int)
+    {
+      if (!(where & SSL_CB_HANDSHAKE_DONE))
+        return;
+
+      // Count once by connection (TLS 1.3 calls again after the tickets)
+      auto session = static_cast<accepted_session*>(SSL_get_ex_data(ssl, accepted_session_index()));
+      if (!session || session->counted)
+        return;
+
+      session->counted = true;
+      if (SSL_session_reused(ssl))
+        ++session->counters->hits;
+      else
+        ++session->counters->misses;
+    }
   }
 
-  tls_socket_serv::tls_socket_serv()
+  // Shared by the server and its threads, stable in the server moves
+  struct tls_handshake_workers
+  {
+    mutable mutex mtx;
+    condition_variable cv_pending;
+    condition_variable cv_established;
+
+    // Accepted waiting a worker and the established ones
+    deque<tls_socket> pending;
+    deque<tls_socket> established;
+
+    // Pending + in handshake
+    size_t in_flight { 0 };
+    size_t max_in_flight;
+    uint64_t failed { 0 };
+    atomic<bool> stop { false };
+
+    vector<jthread> threads;
+
+    tls_handshake_workers(size_t workers, size_t max_in_flight)
+      : max_in_flight { max(max_in_flight, size_t { 1 }) }
+    {
+      for (size_t i = 0; i < max(workers, size_t { 1 }); ++i)
+        threads.emplace_back([this] { this->run(); });
+    }
+
+    ~tls_handshake_workers()
+    {
+      {
+        lock_guard lck { mtx };
+        stop = true;
+      }
+      cv_pending.notify_all();
+
+      // Join before the queues are destroyed (the handshakes in progress see the stop in a wait step)
+      threads.clear();
+    }
+
+    void run()
+    {
+      while (true)
+      {
+        unique_lock lck { mtx };
+        cv_pending.wait(lck, [this] { return stop || !pending.empty(); });
+        if (stop)
+          return;
+
+        auto sock = move(pending.front());
+        pending.pop_front();
+        lck.unlock();
+
+        // The slow or stalled clients give up in the handshake timeout
+        const auto time_expire = steady_clock::now() + cfg::net::tls_handshake_timeout;
+        bool ok = false;
+        try {
+          while (!stop)
+          {
+            const auto status = sock.handshake_step();
+            if (status == tls_socket::handshake_status::done)
+            {
+              ok = true;
+              break;
+            }
+
+            const auto now = steady_clock::now();
+            if (now >= time_expire)
+              break;
+
+            const auto wait_time = min(ceil<milliseconds>(time_expire - now), cfg::net::wait_io_step_max);
+            if (status == tls_socket::handshake_status::want_read)
+              sock.wait_readable(wait_time);
+            else
+              sock.wait_writable(wait_time);
+          }
+        } catch (const exception&) {
+          ok = false;
+        }
+
+        lck.lock();
+        --in_flight;
+        if (ok)
+          established.push_back(move(sock));
+        else
+          ++failed;
+        lck.unlock();
+
+        cv_established.notify_one();
+      }
+    }
+  };
+
+  void server_session_setup(SSL_CTX* ctx)
   {
-    call_once(init_lib, initialize_OpenSSL);
+    // Session tickets with the listener keys and the resumption counters
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticket_key_callback);
+    SSL_CTX_set_info_callback(ctx, handshake_info_callback);
 
-    openssl_ctx();
+    SSL_CTX_sess_set_cache_size(ctx, static_cast<long>(cfg::net::tls_server_session_cache_size));
+    SSL_CTX_set_timeout(ctx, static_cast<long>(cfg::net::tls_session_timeout.count()));
   }
 
-  tls_socket_serv::tls_socket_serv(unsigned port, string pubkey_path, string privkey_path)
+  tls_socket_serv::tls_socket_serv()
+    : m_ticket_keys { make_shared<tls_ticket_keys>() }
+    , m_session_counters { make_shared<tls_session_counters>() }
   {
-    call_once(init_lib, initialize_OpenSSL);
 
-    ctxssl_ini ini;
+  }
 
+  tls_socket_serv::tls_socket_serv(unsigned port, string pubkey_path, string privkey_path)
+    : tls_socket_serv {}
+  {
     this->listen(port, move(pubkey_path), move(privkey_path));
+  }
 
-    ini.set_initialized();
+  tls_socket_serv::tls_socket_serv(unsigned port, string pubkey_path, string privkey_path, tls_context ctx)
+    : tls_socket_serv {}
+  {
+    this->listen(port, move(pubkey_path), move(privkey_path), move(ctx));
   }
 
   tls_socket_serv::tls_socket_serv(tls_socket_serv&& other)
-    : m_sock { move(other.m_sock) }
+    : m_ctx { move(other.m_ctx) }
+    , m_sock { move(other.m_sock) }
     , m_pubkey_path { move(other.m_pubkey_path) }
     , m_privkey_path { move(other.m_privkey_path) }
+    , m_ktls { other.m_ktls }
+    , m_ticket_keys { move(other.m_ticket_keys) }
+    , m_session_counters { move(other.m_session_counters) }
+    , m_workers { move(other.m_workers) }
   {
-    openssl_ctx();
+
   }
 
   tls_socket_serv& tls_socket_serv::operator=(tls_socket_serv&& other)
   {
+    swap(m_ctx, other.m_ctx);
     swap(m_sock, other.m_sock);
     swap(m_pubkey_path, other.m_pubkey_path);
     swap(m_privkey_path, other.m_privkey_path);
+    swap(m_ktls, other.m_ktls);
+    swap(m_ticket_keys, other.m_ticket_keys);
+    swap(m_session_counters, other.m_session_counters);
+    swap(m_workers, other.m_workers);
 
     return *this;
   }
 
   tls_socket_serv::~tls_socket_serv()
   {
-    openssl_ctx_free();
+
   }
 
   void tls_socket_serv::listen(unsigned port, string pubkey_path, string privkey_path)
   {
-    // TLS Certificates configuration
-    if(SSL_CTX_use_certificate_file(openssl_ctx(), pubkey_path.c_str(), SSL_FILETYPE_PEM) <= 0)
-      throw nes_exc { "Public Key configuration error." };
-
-    if(SSL_CTX_use_PrivateKey_file(openssl_ctx(), privkey_path.c_str(), SSL_FILETYPE_PEM) <= 0)
-      throw nes_exc { "Private Key configuration error." };
-
-    if (!SSL_CTX_check_private_key(openssl_ctx()))
-      throw nes_exc { "Public/Private configuration mismatch." };
+    m_ctx.use_certificate(pubkey_path, privkey_path);
 
     m_sock.listen(port);
 
@@ -108,6 +289,20 @@ namespace nes::net {
     m_privkey_path = move(privkey_path);
   }
 
+  void tls_socket_serv::listen(unsigned port, string pubkey_path, string privkey_path, tls_context ctx)
+  {
+    if (ctx.context_role() != tls_context::role::server)
+      throw nes_exc { "The TLS listening needs a server context." };
+
+    m_ctx = move(ctx);
+    this->listen(port, move(pubkey_path), move(privkey_path));
+  }
+
+  const tls_context& tls_socket_serv::context() const
+  {
+    return m_ctx;
+  }
+
   unsigned tls_socket_serv::ipv4_port() const
   {
     return m_sock.ipv4_port();
@@ -133,13 +328,57 @@ namespace nes::net {
     return m_sock.has_client();
   }
 
+  void tls_socket_serv::set_session_cache(size_t size, seconds timeout)
+  {
+    SSL_CTX_sess_set_cache_size(m_ctx.native_handle(), static_cast<long>(size));
+    SSL_CTX_set_timeout(m_ctx.native_handle(), static_cast<long>(timeout.count()));
+  }
+
+  const shared_ptr<tls_ticket_keys>& tls_socket_serv::ticket_keys() const
+  {
+    return m_ticket_keys;
+  }
+
+  void tls_socket_serv::set_ticket_keys(shared_ptr<tls_ticket_keys> keys)
+  {
+    if (!keys)
+      throw nes_exc { "Session ticket keys not defined." };
+
+    m_ticket_keys = move(keys);
+  }
+
+  uint64_t tls_socket_serv::session_hits() const
+  {
+    return m_session_counters ? m_session_counters->hits.load() : 0;
+  }
+
+  uint64_t tls_socket_serv::session_misses() const
+  {
+    return m_session_counters ? m_session_counters->misses.load() : 0;
+  }
+
+  void tls_socket_serv::enable_ktls(bool enable)
+  {
+    m_ktls = enable;
+  }
+
+  bool tls_socket_serv::ktls_enabled() const
+  {
+    return m_ktls;
+  }
+
+  tls_socket_serv::native_handle_type tls_socket_serv::native_handle() const
+  {
+    return m_sock.native_handle();
+  }
+
   optional<tls_socket> tls_socket_serv::accept()
   {
     auto c = m_sock.accept();
     if (!c)
       return nullopt;
 
-    SSL *sock_ssl = SSL_new(openssl_ctx());
+    SSL *sock_ssl = SSL_new(m_ctx.native_handle());
     if (!sock_ssl)
       throw nes_exc { "Not possible alocate the OpenSSL client context." };
     sockssl_rai csock_ssl(sock_ssl);
@@ -148,8 +387,95 @@ namespace nes::net {
     if (ret != 1)
       throw nes_exc { "Can not bind the SSL handle with native socket." };
 
+    // Resumption with the listener keys
+    SSL_set_ex_data(csock_ssl.handle(), accepted_session_index(),
+      new accepted_session { m_ticket_keys, m_session_counters });
+
     // Ok, adapt the handler and socket to the class
-    return tls_socket { csock_ssl.release(), move(*c) };
+    tls_socket cli { csock_ssl.release(), move(*c) };
+    if (m_ktls)
+      cli.enable_ktls();
+
+    return cli;
+  }
+
+  void tls_socket_serv::start_handshake_workers(size_t workers, size_t max_in_flight)
+  {
+    if (m_workers)
+      throw nes_exc { "Handshake workers already started." };
+
+    m_workers = make_unique<tls_handshake_workers>(workers, max_in_flight);
+  }
+
+  void tls_socket_serv::stop_handshake_workers()
+  {
+    // The connections not established are closed
+    m_workers.reset();
+  }
+
+  optional<tls_socket> tls_socket_serv::accept_established(milliseconds wait_time)
+  {
+    if (!m_workers)
+      throw nes_exc { "Handshake workers not started." };
+
+    const auto time_expire = steady_clock::now() + wait_time;
+    auto& w = *m_workers;
+    while (true)
+    {
+      // New connections to the workers, under the limit
+      while (true)
+      {
+        {
+          lock_guard lck { w.mtx };
+          if (w.in_flight >= w.max_in_flight)
+            break;
+        }
+
+        auto c = this->accept();
+        if (!c)
+          break;
+
+        {
+          lock_guard lck { w.mtx };
+          w.pending.push_back(move(*c));
+          ++w.in_flight;
+        }
+        w.cv_pending.notify_one();
+      }
+
+      unique_lock lck { w.mtx };
+      if (!w.established.empty())
+      {
+        auto ret = move(w.established.front());
+        w.established.pop_front();
+        return ret;
+      }
+
+      // Wake to accept again (new connections are not notified)
+      const auto now = steady_clock::now();
+      if (now >= time_expire)
+        return nullopt;
+
+      w.cv_established.wait_for(lck, min<steady_clock::duration>(time_expire - now, cfg::net::wait_io_step_min));
+    }
+  }
+
+  size_t tls_socket_serv::handshakes_in_flight() const
+  {
+    if (!m_workers)
+      return 0;
+
+    lock_guard lck { m_workers->mtx };
+    return m_workers->in_flight;
+  }
+
+  uint64_t tls_socket_serv::handshakes_failed() const
+  {
+    if (!m_workers)
+      return 0;
+
+    lock_guard lck { m_workers->mtx };
+    return m_workers->failed;
   }
 
 }
@@ -0,0 +1,64 @@
+#include "tls_ticket_keys.h"
+
+#include <algorithm>
+#include <openssl/rand.h>
+#include "nes_exc.h"
+using namespace std;
+using namespace std::chrono;
+
+namespace nes::net {
+
+  tls_ticket_keys::tls_ticket_keys(seconds rotation, size_t kept)
+    : m_rotation { rotation }
+    , m_kept { max(kept, size_t { 1 }) }
+  {
+    this->rotate_locked();
+  }
+
+  void tls_ticket_keys::rotate_locked()
+  {
+    key k;
+    if (RAND_bytes(k.name.data(), static_cast<int>(k.name.size())) != 1 ||
+        RAND_bytes(k.aes_key.data(), static_cast<int>(k.aes_key.size())) != 1 ||
+        RAND_bytes(k.hmac_key.data(), static_cast<int>(k.hmac_key.size())) != 1)
+      throw nes_exc { "Error generating the session ticket key." };
+
+    m_keys.push_front(k);
+    if (m_keys.size() > m_kept)
+      m_keys.pop_back();
+
+    m_rotated = steady_clock::now();
+  }
+
+  void tls_ticket_keys::rotate()
+  {
+    lock_guard lck { m_mtx };
+    this->rotate_locked();
+  }
+
+  size_t tls_ticket_keys::size() const
+  {
+    lock_guard lck { m_mtx };
+    return m_keys.size();
+  }
+
+  tls_ticket_keys::key tls_ticket_keys::current()
+  {
+    lock_guard lck { m_mtx };
+    if (steady_clock::now() - m_rotated >= m_rotation)
+      this->rotate_locked();
+
+    return m_keys.front();
+  }
+
+  optional<pair<tls_ticket_keys::key, bool>> tls_ticket_keys::find(span<const unsigned char, 16> name) const
+  {
+    lock_guard lck { m_mtx };
+    auto it = ranges::find_if(m_keys, [&] (const key& k) { return ranges::equal(k.name, name); });
+    if (it == m_keys.end())
+      return nullopt;
+
+    return pair { *it, it == m_keys.begin() };
+  }
+
+}
@@ -1,15 +1,23 @@
 #include "unix_socket.h"
 
 #include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <chrono>
 #include <cstring>
 #include <fcntl.h>
 #include <functional>
+#include <limits>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <poll.h>
 #include <stdexcept>
 #include <string>
@@ -20,6 +28,7 @@
 #include "nes_exc.h"
 #include "socket_util.h"
 using namespace std;
+using namespace std::chrono;
 using namespace std::chrono_literals;
 using namespace nes::net;
 using namespace nes;
@@ -49,6 +58,10 @@ namespace nes::so {
     : m_unix_sd { other.m_unix_sd }
     , m_ipv4_address { move(other.m_ipv4_address) }
     , m_ipv4_port { other.m_ipv4_port }
+    , m_zerocopy_threshold { other.m_zerocopy_threshold }
+    , m_zerocopy_sent { other.m_zerocopy_sent }
+    , m_zerocopy_completed { other.m_zerocopy_completed }
+    , m_zerocopy_copied { other.m_zerocopy_copied }
   {
     other.m_unix_sd = SOCKET_INVALID;
   }
@@ -61,6 +74,11 @@ namespace nes::so {
     m_ipv4_address = move(other.m_ipv4_address);
     m_ipv4_port = other.m_ipv4_port;
 
+    m_zerocopy_threshold = other.m_zerocopy_threshold;
+    m_zerocopy_sent = other.m_zerocopy_sent;
+    m_zerocopy_completed = other.m_zerocopy_completed;
+    m_zerocopy_copied = other.m_zerocopy_copied;
+
     return *this;
   }
 
@@ -256,42 +274,308 @@ namespace nes::so {
   }
 
   void unix_socket::send(span<const byte> data_span)
+  {
+    // Gives up only if no progress at all in the wait time
+    while (data_span.size())
+    {
+      auto sent = this->send(data_span, cfg::net::wait_io_send_max);
+      if (!sent)
+        throw socket_timeout { "Wait time ({}) expired while sending data! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, data_span.size() };
+
+      data_span = data_span.subspan(sent);
+    }
+
+    // The caller can reuse the data after return
+    if (!this->wait_zerocopy(cfg::net::wait_io_send_max))
+      throw socket_timeout { "Wait time ({}) expired while waiting the zero copy send completion!",
+                             cfg::net::wait_io_send_max };
+  }
+
+  size_t unix_socket::send(span<const byte> data_span, milliseconds time_expire)
+  {
+    return this->send_gather(span { &data_span, 1 }, 0, time_expire);
+  }
+
+  void unix_socket::send(span<const span<const byte>> buffers)
+  {
+    size_t total_size = 0;
+    for (const auto& buffer : buffers)
+      total_size += buffer.size();
+
+    // Gives up only if no progress at all in the wait time
+    size_t sent_total = 0;
+    while (sent_total < total_size)
+    {
+      auto sent = this->send_gather(buffers, sent_total, cfg::net::wait_io_send_max);
+      if (!sent)
+        throw socket_timeout { "Wait time ({}) expired while sending data! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, total_size - sent_total };
+
+      sent_total += sent;
+    }
+
+    // The caller can reuse the data after return
+    if (!this->wait_zerocopy(cfg::net::wait_io_send_max))
+      throw socket_timeout { "Wait time ({}) expired while waiting the zero copy send completion!",
+                             cfg::net::wait_io_send_max };
+  }
+
+  size_t unix_socket::send(span<const span<const byte>> buffers, milliseconds time_expire)
+  {
+    return this->send_gather(buffers, 0, time_expire);
+  }
+
+  size_t unix_socket::send_gather(span<const span<const byte>> buffers, size_t offset, milliseconds time_expire)
   {
     if (!this->is_connected())
       throw nes_exc { "Socket is not connected, cannot send data." };
 
-    // Send the data in cfg::net::packet_size chunks
-    size_t retry_count = 0;
-    auto interval = cfg::net::wait_io_step_min;
-    while (data_span.size())
+    // Current position, the buffer index and the offset inside it
+    size_t idx = 0;
+    while (idx < buffers.size() && offset >= buffers[idx].size())
+      offset -= buffers[idx++].size();
+
+    // Each sendmsg writes as much as the socket accepts (no packet chunks)
+    const auto start = steady_clock::now();
+    array<iovec, 64> iov;
+    size_t sent = 0;
+    bool zerocopy = m_zerocopy_threshold > 0;
+    while (idx < buffers.size())
     {
-      auto chunk_size = min(data_span.size(), cfg::net::packet_size);
-      auto chunk = data_span.first(chunk_size);
+      size_t iov_count = 0;
+      size_t iov_size = 0;
+      for (auto i = idx; i < buffers.size() && iov_count < iov.size(); ++i)
+      {
+        const auto buffer = buffers[i].subspan(i == idx ? offset : 0);
+        if (!buffer.empty())
+          iov[iov_count++] = { const_cast<byte*>(buffer.data()), buffer.size() };
+        iov_size += buffer.size();
+      }
+
+      // Only empty buffers remaining
+      if (!iov_count)
+        break;
 
-      auto ret = ::send(m_unix_sd, reinterpret_cast<const char*>(chunk.data()), chunk.size(), 0);
+      msghdr msg {};
+      msg.msg_iov = iov.data();
+      msg.msg_iovlen = iov_count;
+
+      // The pages are pinned instead of copied, only worth for big sends
+      int flags = MSG_NOSIGNAL;
+      #ifdef MSG_ZEROCOPY
+      if (zerocopy && iov_size >= m_zerocopy_threshold)
+        flags |= MSG_ZEROCOPY;
+      #endif
+
+      auto ret = sendmsg(m_unix_sd, &msg, flags);
       if (ret == -1)
       {
-        if (retry_count < cfg::net::io_max_retry && errno == EWOULDBLOCK)
+        #ifdef MSG_ZEROCOPY
+        if (errno == ENOBUFS && (flags & MSG_ZEROCOPY))
         {
-          // As get more tries increase the wait
-          this_thread::sleep_for(interval);
-          retry_count++;
-          interval = calculate_interval_retry(retry_count);
+          // Pinned memory limit (optmem_max), copy in this call
+          zerocopy = false;
+          continue;
         }
+        #endif
+
+        if (errno == EWOULDBLOCK || errno == EINTR)
+        {
+          // Socket buffer full, wait until it has room or the time expire
+          const auto elapsed = steady_clock::now() - start;
+          if (elapsed >= time_expire)
+            break;
+
+          this->wait_writable(ceil<milliseconds>(time_expire - elapsed));
+        }
+        else if (errno == EPIPE || errno == ECONNRESET)
+          throw socket_disconnected { "Socket closed by destination." };
         else
           throw nes_exc { "Error on socket send data. Error: {} - '{}'!", errno, strerror(errno) };
       }
       else
       {
-        chunk_size = ret;
-        retry_count = 0;
-        interval = cfg::net::wait_io_step_min;
+        #ifdef MSG_ZEROCOPY
+        if (flags & MSG_ZEROCOPY)
+          ++m_zerocopy_sent;
+        #endif
+
+        // Advance the position by the bytes written
+        sent += static_cast<size_t>(ret);
+        offset += static_cast<size_t>(ret);
+        while (idx < buffers.size() && offset >= buffers[idx].size())
+          offset -= buffers[idx++].size();
       }
+    }
 
-      // Shrink the span
-      data_span = data_span.last(data_span.size() - chunk_size);
+    return sent;
+  }
+
+  namespace {
+    // Aux RAII file descriptor
+    class fd_raii final
+    {
+      int m_fd;
+    public:
+      fd_raii(int fd) : m_fd { fd } {};
+      ~fd_raii() { if (m_fd >= 0) close(m_fd); };
+      fd_raii(const fd_raii&) = delete;
+      fd_raii& operator=(const fd_raii&) = delete;
+      int handle() const { return m_fd; };
+    };
+
+    // Aux RAII pipe (splice intermediate)
+    class pipe_raii final
+    {
+      int m_fds[2] { -1, -1 };
+    public:
+      pipe_raii() = default;
+      ~pipe_raii() { for (auto fd : m_fds) if (fd >= 0) close(fd); };
+      pipe_raii(const pipe_raii&) = delete;
+      pipe_raii& operator=(const pipe_raii&) = delete;
+      int read_end() const { return m_fds[0]; };
+      int write_end() const { return m_fds[1]; };
+
+      void open()
+      {
+        if (pipe2(m_fds, O_CLOEXEC) != 0)
+          throw nes_exc { "Error on create the splice pipe. Error {}: '{}'.", errno, strerror(errno) };
+      };
+    };
+
+    int open_file(const filesystem::path& path)
+    {
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+        throw nes_exc { "Error on open the file '{}' to send. Error {}: '{}'.", path.string(), errno, strerror(errno) };
+
+      return fd;
     }
+  }
 
+  void unix_socket::send_file(native_file_type file, uint64_t offset, uint64_t length)
+  {
+    // Gives up only if no progress at all in the wait time
+    while (length)
+    {
+      auto sent = this->send_file(file, offset, length, cfg::net::wait_io_send_max);
+      if (!sent)
+      {
+        // End of file
+        struct stat file_stat;
+        if (fstat(file, &file_stat) == 0 && offset >= static_cast<uint64_t>(file_stat.st_size))
+          break;
+
+        throw socket_timeout { "Wait time ({}) expired while sending the file! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, length };
+      }
+
+      offset += sent;
+      length -= sent;
+    }
+  }
+
+  void unix_socket::send_file(const filesystem::path& path, uint64_t offset, uint64_t length)
+  {
+    fd_raii file { open_file(path) };
+    this->send_file(file.handle(), offset, length);
+  }
+
+  uint64_t unix_socket::send_file(const filesystem::path& path, uint64_t offset, uint64_t length,
+    milliseconds time_expire)
+  {
+    fd_raii file { open_file(path) };
+    return this->send_file(file.handle(), offset, length, time_expire);
+  }
+
+  uint64_t unix_socket::send_file(native_file_type file, uint64_t offset, uint64_t length, milliseconds time_expire)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot send data." };
+
+    // Truncate at the end of the file
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0)
+      throw nes_exc { "Error on stat the file to send. Error {}: '{}'.", errno, strerror(errno) };
+
+    const auto file_size = static_cast<uint64_t>(file_stat.st_size);
+    if (offset >= file_size)
+      return 0;
+    length = min(length, file_size - offset);
+
+    // The file pages go to the socket inside the kernel (no user space copy)
+    // Without sendfile support (some file systems) moves through a pipe with splice
+    const auto start = steady_clock::now();
+    uint64_t sent = 0;
+    bool use_splice = false;
+    pipe_raii pipe;
+    size_t in_pipe = 0;
+    while (sent < length)
+    {
+      const auto chunk = static_cast<size_t>(min<uint64_t>(length - sent, numeric_limits<int>::max()));
+
+      ssize_t ret = 0;
+      if (!use_splice)
+      {
+        auto file_offset = static_cast<off_t>(offset + sent);
+        ret = sendfile(m_unix_sd, file, &file_offset, chunk);
+        if (ret == -1 && (errno == EINVAL || errno == ENOSYS))
+        {
+          pipe.open();
+          use_splice = true;
+          continue;
+        }
+      }
+      else
+      {
+        // File to pipe only when the pipe was drained
+        if (!in_pipe)
+        {
+          auto file_offset = static_cast<loff_t>(offset + sent);
+          auto qtde = splice(file, &file_offset, pipe.write_end(), nullptr, chunk, SPLICE_F_MOVE);
+          if (qtde == -1)
+            throw nes_exc { "Error on splice the file data. Error {}: '{}'.", errno, strerror(errno) };
+
+          // File truncated while sending
+          if (qtde == 0)
+            break;
+
+          in_pipe = static_cast<size_t>(qtde);
+        }
+
+        ret = splice(pipe.read_end(), nullptr, m_unix_sd, nullptr, in_pipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (ret > 0)
+          in_pipe -= static_cast<size_t>(ret);
+      }
+
+      if (ret == -1)
+      {
+        if (errno == EWOULDBLOCK || errno == EINTR)
+        {
+          // Socket buffer full, wait until it has room or the time expire
+          // The data left in the pipe is discarded, the caller resumes from the returned position
+          const auto elapsed = steady_clock::now() - start;
+          if (elapsed >= time_expire)
+            break;
+
+          this->wait_writable(ceil<milliseconds>(time_expire - elapsed));
+        }
+        else if (errno == EPIPE || errno == ECONNRESET)
+          throw socket_disconnected { "Socket closed by destination." };
+        else
+          throw nes_exc { "Error on socket send file. Error: {} - '{}'!", errno, strerror(errno) };
+      }
+      else if (ret == 0)
+      {
+        // File truncated while sending
+        break;
+      }
+      else
+        sent += static_cast<uint64_t>(ret);
+    }
+
+    return sent;
   }
 
   vector<byte> unix_socket::receive()
@@ -330,4 +614,266 @@ namespace nes::so {
     return ret;
   }
 
+  size_t unix_socket::receive_into(span<byte> buffer)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot receive data." };
+
+    size_t qtde_total = 0;
+    while (qtde_total < buffer.size())
+    {
+      auto qtde = recv(m_unix_sd, reinterpret_cast<void*>(buffer.data() + qtde_total), buffer.size() - qtde_total, 0);
+
+      if (qtde == SOCKET_ERROR)
+      {
+        // No data to receive, but the connection is active
+        if (errno == EWOULDBLOCK)
+          break;
+        else
+          throw nes_exc { "Error on socket data receive. Error: {}.", errno };
+      }
+      else if (qtde == 0)
+      {
+        // Closed socket, if there is data breaks
+        if (qtde_total > 0)
+          break;
+
+        throw socket_disconnected { "Socket closed normally." };
+      }
+
+      qtde_total += static_cast<size_t>(qtde);
+    }
+
+    return qtde_total;
+  }
+
+  size_t unix_socket::receive_into(span<const span<byte>> buffers)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot receive data." };
+
+    // Current position, the buffer index and the offset inside it
+    size_t idx = 0;
+    size_t offset = 0;
+    array<iovec, 64> iov;
+    size_t qtde_total = 0;
+    while (true)
+    {
+      // Skip the full (and empty) buffers
+      while (idx < buffers.size() && offset >= buffers[idx].size())
+        offset -= buffers[idx++].size();
+
+      size_t iov_count = 0;
+      for (auto i = idx; i < buffers.size() && iov_count < iov.size(); ++i)
+      {
+        const auto buffer = buffers[i].subspan(i == idx ? offset : 0);
+        if (!buffer.empty())
+          iov[iov_count++] = { buffer.data(), buffer.size() };
+      }
+
+      // All buffers full
+      if (!iov_count)
+        break;
+
+      msghdr msg {};
+      msg.msg_iov = iov.data();
+      msg.msg_iovlen = iov_count;
+
+      auto qtde = recvmsg(m_unix_sd, &msg, 0);
+      if (qtde == SOCKET_ERROR)
+      {
+        // No data to receive, but the connection is active
+        if (errno == EWOULDBLOCK)
+          break;
+        else
+          throw nes_exc { "Error on socket data receive. Error: {}.", errno };
+      }
+      else if (qtde == 0)
+      {
+        // Closed socket, if there is data breaks
+        if (qtde_total > 0)
+          break;
+
+        throw socket_disconnected { "Socket closed normally." };
+      }
+
+      qtde_total += static_cast<size_t>(qtde);
+      offset += static_cast<size_t>(qtde);
+    }
+
+    return qtde_total;
+  }
+
+  bool unix_socket::wait_readable(milliseconds time_expire)
+  {
+    return this->wait_events(POLLIN, time_expire);
+  }
+
+  bool unix_socket::wait_writable(milliseconds time_expire)
+  {
+    return this->wait_events(POLLOUT, time_expire);
+  }
+
+  bool unix_socket::set_notsent_lowat(size_t qtde)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot set the not sent low watermark." };
+
+    #ifdef TCP_NOTSENT_LOWAT
+    // Writable readiness only when the unsent bytes are below the limit, the rest waits in user space
+    auto lowat = static_cast<int>(min<size_t>(qtde, numeric_limits<int>::max()));
+    return setsockopt(m_unix_sd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) == 0;
+    #else
+    static_cast<void>(qtde);
+    return false;
+    #endif
+  }
+
+  bool unix_socket::enable_zerocopy(size_t threshold)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot enable the zero copy send." };
+
+    #if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    int enable = 1;
+    if (setsockopt(m_unix_sd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) != 0)
+      return false;
+
+    m_zerocopy_threshold = max(threshold, size_t { 1 });
+    return true;
+    #else
+    static_cast<void>(threshold);
+    return false;
+    #endif
+  }
+
+  uint32_t unix_socket::zerocopy_sent() const
+  {
+    return m_zerocopy_sent;
+  }
+
+  uint32_t unix_socket::zerocopy_completed()
+  {
+    if (m_zerocopy_completed != m_zerocopy_sent)
+      this->read_zerocopy_notifications();
+
+    return m_zerocopy_completed;
+  }
+
+  uint32_t unix_socket::zerocopy_copied() const
+  {
+    return m_zerocopy_copied;
+  }
+
+  bool unix_socket::wait_zerocopy(milliseconds time_expire)
+  {
+    // The notifications raise POLLERR
+    const auto start = steady_clock::now();
+    while (this->zerocopy_completed() != m_zerocopy_sent)
+    {
+      const auto remaining = remaining_time(start, time_expire);
+      if (remaining.count() <= 0)
+        return false;
+
+      pollfd fd_sock;
+      fd_sock.fd = m_unix_sd;
+      fd_sock.events = 0;
+      fd_sock.revents = 0;
+
+      auto timeout_ms = static_cast<int>(clamp<milliseconds::rep>(remaining.count(), 1, numeric_limits<int>::max()));
+      int ret = poll(&fd_sock, 1, timeout_ms);
+      if (ret < 0 && errno != EINTR)
+        throw nes_exc { "Error on socket poll. Error {}: '{}'.", errno, strerror(errno) };
+
+      // Hangup/error stays raised, without notifications left the sends will not complete (no spin)
+      if (ret > 0 && (fd_sock.revents & (POLLHUP | POLLERR | POLLNVAL)) && !this->read_zerocopy_notifications() &&
+          m_zerocopy_completed != m_zerocopy_sent)
+        throw socket_disconnected { "Connection ended with {} zero copy sends not completed!",
+                                    m_zerocopy_sent - m_zerocopy_completed };
+    }
+
+    return true;
+  }
+
+  size_t unix_socket::read_zerocopy_notifications()
+  {
+    size_t qtde = 0;
+
+    #ifdef SO_EE_ORIGIN_ZEROCOPY
+    while (true)
+    {
+      alignas(cmsghdr) array<char, 128> control;
+      msghdr msg {};
+      msg.msg_control = control.data();
+      msg.msg_controllen = control.size();
+
+      if (recvmsg(m_unix_sd, &msg, MSG_ERRQUEUE) == SOCKET_ERROR)
+      {
+        // Error queue empty
+        if (errno == EWOULDBLOCK || errno == EINTR)
+          break;
+
+        throw nes_exc { "Error on socket error queue receive. Error {}: '{}'.", errno, strerror(errno) };
+      }
+
+      for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+      {
+        if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+            !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+          continue;
+
+        sock_extended_err ee;
+        memcpy(&ee, CMSG_DATA(cmsg), sizeof(ee));
+        if (ee.ee_errno != 0 || ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+          continue;
+
+        // Range [ee_info, ee_data] of the completed sends
+        const auto completed = ee.ee_data - ee.ee_info + 1;
+        m_zerocopy_completed += completed;
+        if (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+          m_zerocopy_copied += completed;
+        ++qtde;
+      }
+    }
+    #endif
+
+    return qtde;
+  }
+
+  bool unix_socket::wait_events(short events, milliseconds time_expire)
+  {
+    if (m_unix_sd == SOCKET_INVALID)
+      throw nes_exc { "Socket is not configured, cannot wait data." };
+
+    const auto start = steady_clock::now();
+    while (true)
+    {
+      pollfd fd_sock;
+      fd_sock.fd = m_unix_sd;
+      fd_sock.events = events;
+      fd_sock.revents = 0;
+
+      const auto remaining = remaining_time(start, time_expire);
+      auto timeout_ms = static_cast<int>(clamp<milliseconds::rep>(remaining.count(), 0, numeric_limits<int>::max()));
+      int ret = poll(&fd_sock, 1, timeout_ms);
+      if (ret < 0)
+      {
+        // Interrupted, let the caller check the time
+        if (errno == EINTR)
+          return false;
+
+        throw nes_exc { "Error on socket poll. Error {}: '{}'.", errno, strerror(errno) };
+      }
+
+      // The zero copy notifications also raise POLLERR, consume them and keep waiting the events
+      if (ret > 0 && events && m_zerocopy_threshold && (fd_sock.revents & POLLERR) &&
+          !(fd_sock.revents & (events | POLLHUP)) && this->read_zerocopy_notifications() &&
+          steady_clock::now() - start < time_expire)
+        continue;
+
+      // Also ready on hangup/error, so the next receive reports it
+      return ret > 0;
+    }
+  }
+
 }
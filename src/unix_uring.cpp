@@ -0,0 +1,502 @@
+#include "unix_uring.h"
+
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <netdb.h>
+#include <unistd.h>
+#include "nes_exc.h"
+using namespace std;
+using namespace nes;
+
+namespace nes::so {
+
+  constexpr int SOCKET_INVALID = -1;
+
+  // User data of the cancel entries (never an operation id)
+  constexpr uint64_t CANCEL_USER_DATA = numeric_limits<uint64_t>::max();
+
+  // Operation data that must live until the completion
+  struct unix_uring::pending_op
+  {
+    uint64_t id;
+    operation op;
+    uint64_t user_data;
+
+    // Accept/Connect address
+    sockaddr_in addr {};
+    socklen_t addr_len { sizeof(sockaddr_in) };
+
+    // Connect target
+    unix_socket* target { nullptr };
+    int connect_sd { SOCKET_INVALID };
+    string ip;
+    unsigned port { 0 };
+  };
+
+  // Aux syscall wrappers (no liburing dependency)
+  namespace {
+    int sys_io_uring_setup(unsigned entries, io_uring_params* p)
+    {
+      return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+    }
+
+    int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+      return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    unsigned load_acquire(unsigned* p)
+    {
+      return atomic_ref<unsigned> { *p }.load(memory_order_acquire);
+    }
+
+    void store_release(unsigned* p, unsigned v)
+    {
+      atomic_ref<unsigned> { *p }.store(v, memory_order_release);
+    }
+
+    template <class T>
+    T* ring_offset(void* base, unsigned offset)
+    {
+      return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+  }
+
+  unix_uring::unix_uring(unsigned entries)
+  {
+    io_uring_params params {};
+    m_ring_fd = sys_io_uring_setup(entries, &params);
+    if (m_ring_fd < 0)
+      throw nes_exc { "Error on create io_uring in linux syscall. Error {}: '{}'.", errno, strerror(errno) };
+
+    // Map the rings, old kernels need two mappings for the submission and completion rings
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+      m_sq_size = m_cq_size = max(m_sq_size, m_cq_size);
+
+    m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd,
+                    IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED)
+    {
+      m_sq_ptr = nullptr;
+      this->release();
+      throw nes_exc { "Error on map the io_uring submission ring. Error {}: '{}'.", errno, strerror(errno) };
+    }
+
+    if (single_mmap)
+      m_cq_ptr = m_sq_ptr;
+    else
+    {
+      m_cq_ptr = mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd,
+                      IORING_OFF_CQ_RING);
+      if (m_cq_ptr == MAP_FAILED)
+      {
+        m_cq_ptr = nullptr;
+        this->release();
+        throw nes_exc { "Error on map the io_uring completion ring. Error {}: '{}'.", errno, strerror(errno) };
+      }
+    }
+
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd,
+                  IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED)
+    {
+      m_sqes = nullptr;
+      this->release();
+      throw nes_exc { "Error on map the io_uring submission entries. Error {}: '{}'.", errno, strerror(errno) };
+    }
+
+    m_sq_head = ring_offset<unsigned>(m_sq_ptr, params.sq_off.head);
+    m_sq_tail = ring_offset<unsigned>(m_sq_ptr, params.sq_off.tail);
+    m_sq_mask = ring_offset<unsigned>(m_sq_ptr, params.sq_off.ring_mask);
+    m_sq_array = ring_offset<unsigned>(m_sq_ptr, params.sq_off.array);
+    m_sq_entries = params.sq_entries;
+
+    m_cq_head = ring_offset<unsigned>(m_cq_ptr, params.cq_off.head);
+    m_cq_tail = ring_offset<unsigned>(m_cq_ptr, params.cq_off.tail);
+    m_cq_mask = ring_offset<unsigned>(m_cq_ptr, params.cq_off.ring_mask);
+    m_cqes = ring_offset<io_uring_cqe>(m_cq_ptr, params.cq_off.cqes);
+  }
+
+  unix_uring::~unix_uring()
+  {
+    this->release();
+  }
+
+  unix_uring::unix_uring(unix_uring&& other) noexcept
+    : m_ring_fd { SOCKET_INVALID }
+  {
+    *this = move(other);
+  }
+
+  unix_uring& unix_uring::operator=(unix_uring&& other) noexcept
+  {
+    swap(m_ring_fd, other.m_ring_fd);
+    swap(m_sq_ptr, other.m_sq_ptr);
+    swap(m_sq_size, other.m_sq_size);
+    swap(m_cq_ptr, other.m_cq_ptr);
+    swap(m_cq_size, other.m_cq_size);
+    swap(m_sqes, other.m_sqes);
+    swap(m_sqes_size, other.m_sqes_size);
+    swap(m_sq_head, other.m_sq_head);
+    swap(m_sq_tail, other.m_sq_tail);
+    swap(m_sq_mask, other.m_sq_mask);
+    swap(m_sq_array, other.m_sq_array);
+    swap(m_sq_entries, other.m_sq_entries);
+    swap(m_cq_head, other.m_cq_head);
+    swap(m_cq_tail, other.m_cq_tail);
+    swap(m_cq_mask, other.m_cq_mask);
+    swap(m_cqes, other.m_cqes);
+    swap(m_to_submit, other.m_to_submit);
+    swap(m_pending, other.m_pending);
+    swap(m_next_id, other.m_next_id);
+
+    return *this;
+  }
+
+  void unix_uring::release()
+  {
+    // The in flight operations are finished before the op data is freed
+    if (!m_pending.empty() && m_sqes && m_cq_ptr && m_sq_ptr)
+      this->cancel_pending();
+
+    if (m_sqes)
+      munmap(m_sqes, m_sqes_size);
+    if (m_cq_ptr && m_cq_ptr != m_sq_ptr)
+      munmap(m_cq_ptr, m_cq_size);
+    if (m_sq_ptr)
+      munmap(m_sq_ptr, m_sq_size);
+    if (m_ring_fd != SOCKET_INVALID)
+      close(m_ring_fd);
+
+    for (auto& [id, p] : m_pending)
+      if (p.connect_sd != SOCKET_INVALID)
+        close(p.connect_sd);
+
+    m_sqes = m_cq_ptr = m_sq_ptr = nullptr;
+    m_ring_fd = SOCKET_INVALID;
+    m_pending.clear();
+  }
+
+  void* unix_uring::next_sqe()
+  {
+    if (m_ring_fd == SOCKET_INVALID)
+      throw nes_exc { "io_uring not initialized." };
+
+    // Full submission queue
+    const unsigned tail = *m_sq_tail;
+    if (tail - load_acquire(m_sq_head) >= m_sq_entries)
+      return nullptr;
+
+    auto sqe = static_cast<io_uring_sqe*>(m_sqes) + (tail & *m_sq_mask);
+    memset(sqe, 0, sizeof(io_uring_sqe));
+
+    return sqe;
+  }
+
+  unix_uring::pending_op& unix_uring::new_op(operation op, uint64_t user_data)
+  {
+    const auto id = m_next_id++;
+    auto& p = m_pending[id];
+    p.id = id;
+    p.op = op;
+    p.user_data = user_data;
+
+    return p;
+  }
+
+  void unix_uring::publish(void* entry, uint64_t id)
+  {
+    // Publish the filled entry to the kernel, the tail is the last write
+    auto sqe = static_cast<io_uring_sqe*>(entry);
+    sqe->user_data = id;
+
+    const unsigned tail = *m_sq_tail;
+    const unsigned idx = tail & *m_sq_mask;
+    m_sq_array[idx] = idx;
+    store_release(m_sq_tail, tail + 1);
+    m_to_submit++;
+  }
+
+  void unix_uring::cancel_pending()
+  {
+    vector<uint64_t> ids;
+    ids.reserve(m_pending.size());
+    for (const auto& [id, p] : m_pending)
+      ids.push_back(id);
+
+    try {
+      // The queued entries go to the kernel before their cancels
+      for (auto id : ids)
+      {
+        auto sqe = static_cast<io_uring_sqe*>(this->next_sqe());
+        while (!sqe)
+        {
+          // Full submission queue, send it and free the completion queue
+          this->submit();
+          this->discard_completions();
+          sqe = static_cast<io_uring_sqe*>(this->next_sqe());
+        }
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = id;
+        this->publish(sqe, CANCEL_USER_DATA);
+      }
+
+      // A connect in progress is not cancelable, the shutdown of its socket finishes it
+      for (const auto& [id, p] : m_pending)
+        if (p.connect_sd != SOCKET_INVALID)
+          shutdown(p.connect_sd, SHUT_RDWR);
+
+      // Wait all the operations (canceled or already complete)
+      this->discard_completions();
+      while (!m_pending.empty())
+      {
+        this->submit(1);
+        this->discard_completions();
+      }
+    } catch (...) {
+      // Ring error, the close of the ring is the last resort
+    }
+  }
+
+  void unix_uring::discard_completions()
+  {
+    unsigned head = *m_cq_head;
+    const unsigned tail = load_acquire(m_cq_tail);
+    for (; head != tail; head++)
+    {
+      const auto& cqe = static_cast<io_uring_cqe*>(m_cqes)[head & *m_cq_mask];
+
+      // The cancel entries have no op data
+      auto it = m_pending.find(cqe.user_data);
+      if (it == m_pending.end())
+        continue;
+
+      // Nobody gets the new sockets
+      auto& p = it->second;
+      if (p.op == operation::accept && cqe.res >= 0)
+        close(cqe.res);
+      if (p.connect_sd != SOCKET_INVALID)
+        close(p.connect_sd);
+
+      m_pending.erase(it);
+    }
+
+    store_release(m_cq_head, head);
+  }
+
+  bool unix_uring::queue_send(const unix_socket& sock, span<const byte> data, uint64_t user_data)
+  {
+    if (!sock.is_connected())
+      throw nes_exc { "Socket is not connected, cannot send data." };
+
+    auto sqe = static_cast<io_uring_sqe*>(this->next_sqe());
+    if (!sqe)
+      return false;
+
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = sock.native_handle();
+    sqe->addr = reinterpret_cast<uint64_t>(data.data());
+    sqe->len = static_cast<uint32_t>(min<size_t>(data.size(), numeric_limits<uint32_t>::max()));
+    sqe->msg_flags = MSG_NOSIGNAL;
+
+    this->publish(sqe, this->new_op(operation::send, user_data).id);
+    return true;
+  }
+
+  bool unix_uring::queue_receive(const unix_socket& sock, span<byte> data, uint64_t user_data)
+  {
+    if (!sock.is_connected())
+      throw nes_exc { "Socket is not connected, cannot receive data." };
+
+    auto sqe = static_cast<io_uring_sqe*>(this->next_sqe());
+    if (!sqe)
+      return false;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sock.native_handle();
+    sqe->addr = reinterpret_cast<uint64_t>(data.data());
+    sqe->len = static_cast<uint32_t>(min<size_t>(data.size(), numeric_limits<uint32_t>::max()));
+
+    this->publish(sqe, this->new_op(operation::receive, user_data).id);
+    return true;
+  }
+
+  bool unix_uring::queue_accept(const unix_socket& sock, uint64_t user_data)
+  {
+    if (!sock.is_listening())
+      throw nes_exc { "Socket is not listing, cannot accept connection." };
+
+    auto sqe = static_cast<io_uring_sqe*>(this->next_sqe());
+    if (!sqe)
+      return false;
+
+    auto& p = this->new_op(operation::accept, user_data);
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = sock.native_handle();
+    sqe->addr = reinterpret_cast<uint64_t>(&p.addr);
+    sqe->addr2 = reinterpret_cast<uint64_t>(&p.addr_len);
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+
+    this->publish(sqe, p.id);
+    return true;
+  }
+
+  bool unix_uring::queue_connect(unix_socket& sock, string addr, unsigned port, uint64_t user_data)
+  {
+    if (sock.m_unix_sd != SOCKET_INVALID)
+      throw nes_exc { "Socket already configured." };
+
+    auto sqe = static_cast<io_uring_sqe*>(this->next_sqe());
+    if (!sqe)
+      return false;
+
+    // Address Resolution
+    addrinfo addr_res_cfg {};
+    addr_res_cfg.ai_family = AF_INET;
+    addr_res_cfg.ai_socktype = SOCK_STREAM;
+    addr_res_cfg.ai_protocol = IPPROTO_TCP;
+
+    addrinfo *addr_res;
+    if (getaddrinfo(addr.data(), to_string(port).c_str(), &addr_res_cfg, &addr_res))
+      throw nes_exc { "Address resolution error." };
+
+    unique_ptr<addrinfo, function<void(addrinfo*)>> addr_res_ptr {
+      addr_res,
+      [](addrinfo* p) { freeaddrinfo(p); }
+    };
+
+    // Resolved IPv4
+    sockaddr_in addr4;
+    memcpy(&addr4, addr_res->ai_addr, sizeof(addr4));
+
+    string ip;
+    ip.resize(INET_ADDRSTRLEN);
+    const char* res = inet_ntop(AF_INET, &addr4.sin_addr, ip.data(), INET_ADDRSTRLEN);
+    if (!res)
+      throw nes_exc { "Adress IPv4 extraction error." };
+
+    ip.resize(strlen(res));
+
+    // Blocking until connected, the ring waits without blocking the thread
+    int sd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (sd == SOCKET_INVALID)
+      throw nes_exc { "Error on create Socket in linux syscall." };
+
+    auto& p = this->new_op(operation::connect, user_data);
+    p.addr = addr4;
+    p.target = &sock;
+    p.connect_sd = sd;
+    p.ip = move(ip);
+    p.port = port;
+
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = sd;
+    sqe->addr = reinterpret_cast<uint64_t>(&p.addr);
+    sqe->off = sizeof(p.addr);
+
+    this->publish(sqe, p.id);
+    return true;
+  }
+
+  size_t unix_uring::submit(size_t min_complete)
+  {
+    if (!m_to_submit && !min_complete)
+      return 0;
+
+    const unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    int ret = sys_io_uring_enter(m_ring_fd, m_to_submit, static_cast<unsigned>(min_complete), flags);
+    if (ret < 0)
+    {
+      // Interrupted or the completion queue needs to be reaped first
+      if (errno == EINTR || errno == EBUSY || errno == EAGAIN)
+        return 0;
+
+      throw nes_exc { "Error on io_uring submit. Error {}: '{}'.", errno, strerror(errno) };
+    }
+
+    m_to_submit -= static_cast<unsigned>(ret);
+    return static_cast<size_t>(ret);
+  }
+
+  size_t unix_uring::reap(vector<completion>& completions)
+  {
+    unsigned head = *m_cq_head;
+    const unsigned tail = load_acquire(m_cq_tail);
+
+    size_t qtde = 0;
+    for (; head != tail; head++, qtde++)
+    {
+      const auto& cqe = static_cast<io_uring_cqe*>(m_cqes)[head & *m_cq_mask];
+
+      auto it = m_pending.find(cqe.user_data);
+      if (it == m_pending.end())
+        throw nes_exc { "io_uring completion of unknown operation {}.", cqe.user_data };
+
+      auto& p = it->second;
+      completion c { p.user_data, p.op, cqe.res, nullopt };
+
+      if (p.op == operation::accept && cqe.res >= 0)
+      {
+        // New client received (already non-blocking)
+        unix_socket cli;
+        cli.m_unix_sd = cqe.res;
+        cli.m_ipv4_address = inet_ntoa(p.addr.sin_addr);
+        cli.m_ipv4_port = ntohs(p.addr.sin_port);
+        c.result = 0;
+        c.accepted = move(cli);
+      }
+      else if (p.op == operation::connect)
+      {
+        int marks = fcntl(p.connect_sd, F_GETFL, 0);
+        if (cqe.res == 0 && (marks < 0 || fcntl(p.connect_sd, F_SETFL, marks | O_NONBLOCK) != 0))
+          c.result = -errno;
+
+        if (c.result == 0)
+        {
+          // All ok, can set the socket
+          p.target->m_unix_sd = p.connect_sd;
+          p.target->m_ipv4_address = move(p.ip);
+          p.target->m_ipv4_port = p.port;
+        }
+        else
+          close(p.connect_sd);
+
+        p.connect_sd = SOCKET_INVALID;
+      }
+
+      completions.push_back(move(c));
+      m_pending.erase(it);
+    }
+
+    store_release(m_cq_head, head);
+    return qtde;
+  }
+
+  size_t unix_uring::queued() const
+  {
+    return m_to_submit;
+  }
+
+  size_t unix_uring::in_flight() const
+  {
+    return m_pending.size() - m_to_submit;
+  }
+
+}
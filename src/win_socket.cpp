@@ -1,10 +1,12 @@
 #include "win_socket.h"
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <chrono>
 #include <functional>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <thread>
@@ -305,45 +307,212 @@ namespace nes::so {
   }
 
   void win_socket::send(span<const std::byte> data_span)
+  {
+    // Gives up only if no progress at all in the wait time
+    while (data_span.size())
+    {
+      auto sent = this->send(data_span, cfg::net::wait_io_send_max);
+      if (!sent)
+        throw socket_timeout { "Wait time ({}) expired while sending data! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, data_span.size() };
+
+      data_span = data_span.subspan(sent);
+    }
+  }
+
+  size_t win_socket::send(span<const std::byte> data_span, milliseconds time_expire)
+  {
+    return this->send_gather(span { &data_span, 1 }, 0, time_expire);
+  }
+
+  void win_socket::send(span<const span<const std::byte>> buffers)
+  {
+    size_t total_size = 0;
+    for (const auto& buffer : buffers)
+      total_size += buffer.size();
+
+    // Gives up only if no progress at all in the wait time
+    size_t sent_total = 0;
+    while (sent_total < total_size)
+    {
+      auto sent = this->send_gather(buffers, sent_total, cfg::net::wait_io_send_max);
+      if (!sent)
+        throw socket_timeout { "Wait time ({}) expired while sending data! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, total_size - sent_total };
+
+      sent_total += sent;
+    }
+  }
+
+  size_t win_socket::send(span<const span<const std::byte>> buffers, milliseconds time_expire)
+  {
+    return this->send_gather(buffers, 0, time_expire);
+  }
+
+  size_t win_socket::send_gather(span<const span<const std::byte>> buffers, size_t offset, milliseconds time_expire)
   {
     if (!this->is_connected())
       throw nes_exc { "Socket is not connected, cannot send data." };
 
-    // Send the data in cfg::net::packet_size chunks
-    size_t retry_count = 0;
-    auto interval = cfg::net::wait_io_step_min;
-    while (data_span.size())
+    // Current position, the buffer index and the offset inside it
+    size_t idx = 0;
+    while (idx < buffers.size() && offset >= buffers[idx].size())
+      offset -= buffers[idx++].size();
+
+    // Each WSASend writes as much as the socket accepts (no packet chunks)
+    const auto start = steady_clock::now();
+    array<WSABUF, 64> wsa_buf;
+    size_t sent = 0;
+    while (idx < buffers.size())
     {
-      auto chunk_size = min(data_span.size(), cfg::net::packet_size);
-      auto chunk = data_span.first(chunk_size);
+      DWORD buf_count = 0;
+      for (auto i = idx; i < buffers.size() && buf_count < wsa_buf.size(); ++i)
+      {
+        const auto buffer = buffers[i].subspan(i == idx ? offset : 0);
+        if (!buffer.empty())
+          wsa_buf[buf_count++] = { static_cast<ULONG>(min<size_t>(buffer.size(), numeric_limits<ULONG>::max())),
+                                   reinterpret_cast<CHAR*>(const_cast<std::byte*>(buffer.data())) };
+      }
+
+      // Only empty buffers remaining
+      if (!buf_count)
+        break;
 
-      auto ret = ::send(m_winsocket, reinterpret_cast<const char*>(chunk.data()), chunk.size(), 0);
-      if (ret == SOCKET_ERROR)
+      DWORD ret = 0;
+      if (WSASend(m_winsocket, wsa_buf.data(), buf_count, &ret, 0, nullptr, nullptr) == SOCKET_ERROR)
       {
-        if (retry_count < cfg::net::io_max_retry && errno == WSAEWOULDBLOCK)
+        auto erro = WSAGetLastError();
+        if (erro == WSAEWOULDBLOCK)
         {
-          // As get more tries increase the wait
-          this_thread::sleep_for(interval);
-          retry_count++;
-          interval = calculate_interval_retry(retry_count);
+          // Socket buffer full, wait until it has room or the time expire
+          const auto elapsed = steady_clock::now() - start;
+          if (elapsed >= time_expire)
+            break;
+
+          this->wait_writable(ceil<milliseconds>(time_expire - elapsed));
         }
-        else if (errno == WSAECONNABORTED)
+        else if (erro == WSAECONNABORTED || erro == WSAECONNRESET)
           throw socket_disconnected { "Socket closed by destination." };
         else
-          throw nes_exc { "Error on socket send data. Error: {}", msg_err_str(errno) };
+          throw nes_exc { "Error on socket send data. Error: {}", msg_err_str(erro) };
       }
       else
       {
-        chunk_size = ret;
-        retry_count = 0;
-        interval = cfg::net::wait_io_step_min;
+        // Advance the position by the bytes written
+        sent += static_cast<size_t>(ret);
+        offset += static_cast<size_t>(ret);
+        while (idx < buffers.size() && offset >= buffers[idx].size())
+          offset -= buffers[idx++].size();
       }
+    }
+
+    return sent;
+  }
+
+  namespace {
+    // Aux RAII file handle
+    class file_raii final
+    {
+      HANDLE m_file;
+    public:
+      file_raii(HANDLE file) : m_file { file } {};
+      ~file_raii() { if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file); };
+      file_raii(const file_raii&) = delete;
+      file_raii& operator=(const file_raii&) = delete;
+      HANDLE handle() const { return m_file; };
+    };
+
+    HANDLE open_file(const filesystem::path& path)
+    {
+      HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      if (file == INVALID_HANDLE_VALUE)
+        throw nes_exc { "Error on open the file '{}' to send. Error: {}", path.string(), GetLastError() };
 
-      // Shrink the span
-      data_span = data_span.last(data_span.size() - chunk_size);
+      return file;
     }
   }
 
+  void win_socket::send_file(native_file_type file, uint64_t offset, uint64_t length)
+  {
+    // Gives up only if no progress at all in the wait time
+    while (length)
+    {
+      auto sent = this->send_file(file, offset, length, cfg::net::wait_io_send_max);
+      if (!sent)
+      {
+        // End of file
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(file, &file_size) && offset >= static_cast<uint64_t>(file_size.QuadPart))
+          break;
+
+        throw socket_timeout { "Wait time ({}) expired while sending the file! Remaining {} bytes!",
+                               cfg::net::wait_io_send_max, length };
+      }
+
+      offset += sent;
+      length -= sent;
+    }
+  }
+
+  void win_socket::send_file(const filesystem::path& path, uint64_t offset, uint64_t length)
+  {
+    file_raii file { open_file(path) };
+    this->send_file(file.handle(), offset, length);
+  }
+
+  uint64_t win_socket::send_file(const filesystem::path& path, uint64_t offset, uint64_t length,
+    milliseconds time_expire)
+  {
+    file_raii file { open_file(path) };
+    return this->send_file(file.handle(), offset, length, time_expire);
+  }
+
+  uint64_t win_socket::send_file(native_file_type file, uint64_t offset, uint64_t length, milliseconds time_expire)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot send data." };
+
+    // Truncate at the end of the file
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+      throw nes_exc { "Error on get the size of the file to send. Error: {}", GetLastError() };
+
+    if (offset >= static_cast<uint64_t>(file_size.QuadPart))
+      return 0;
+    length = min(length, static_cast<uint64_t>(file_size.QuadPart) - offset);
+
+    // Read in blocks and send, a block not fully sent in the time is read again by the caller resume
+    const auto start = steady_clock::now();
+    vector<std::byte> block(min<uint64_t>(length, 16 * cfg::net::packet_size));
+    uint64_t sent = 0;
+    while (sent < length)
+    {
+      OVERLAPPED pos {};
+      pos.Offset = static_cast<DWORD>(offset + sent);
+      pos.OffsetHigh = static_cast<DWORD>((offset + sent) >> 32);
+
+      DWORD qtde = 0;
+      const auto to_read = static_cast<DWORD>(min<uint64_t>(length - sent, block.size()));
+      if (!ReadFile(file, block.data(), to_read, &qtde, &pos))
+        throw nes_exc { "Error on read the file to send. Error: {}", GetLastError() };
+
+      // File truncated while sending
+      if (qtde == 0)
+        break;
+
+      const auto elapsed = steady_clock::now() - start;
+      const auto block_sent = this->send(span { block }.first(qtde),
+        elapsed < time_expire ? ceil<milliseconds>(time_expire - elapsed) : milliseconds { 0 });
+      sent += block_sent;
+
+      if (block_sent < qtde)
+        break;
+    }
+
+    return sent;
+  }
+
   vector<std::byte> win_socket::receive()
   {
     if (!this->is_connected())
@@ -382,6 +551,164 @@ namespace nes::so {
     return ret;
   }
 
+  size_t win_socket::receive_into(span<std::byte> buffer)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot receive data." };
+
+    size_t qtde_total = 0;
+    while (qtde_total < buffer.size())
+    {
+      auto qtde = recv(m_winsocket, reinterpret_cast<char*>(buffer.data() + qtde_total),
+        static_cast<int>(min<size_t>(buffer.size() - qtde_total, numeric_limits<int>::max())), 0);
+      if (qtde == SOCKET_ERROR)
+      {
+        auto erro = WSAGetLastError();
+
+        // No data to receive, but the connection is active
+        if (erro == WSAEWOULDBLOCK)
+          break;
+        else
+          throw nes_exc { "Error on socket data receive. Error: {}.", msg_err_str(erro) };
+      }
+      else if (qtde == 0)
+      {
+        // Closed socket, if there is data breaks
+        if (qtde_total > 0)
+          break;
+
+        throw socket_disconnected { "Socket closed normally." };
+      }
+
+      qtde_total += static_cast<size_t>(qtde);
+    }
+
+    return qtde_total;
+  }
+
+  size_t win_socket::receive_into(span<const span<std::byte>> buffers)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot receive data." };
+
+    // Current position, the buffer index and the offset inside it
+    size_t idx = 0;
+    size_t offset = 0;
+    array<WSABUF, 64> wsa_buf;
+    size_t qtde_total = 0;
+    while (true)
+    {
+      // Skip the full (and empty) buffers
+      while (idx < buffers.size() && offset >= buffers[idx].size())
+        offset -= buffers[idx++].size();
+
+      DWORD buf_count = 0;
+      for (auto i = idx; i < buffers.size() && buf_count < wsa_buf.size(); ++i)
+      {
+        const auto buffer = buffers[i].subspan(i == idx ? offset : 0);
+        if (!buffer.empty())
+          wsa_buf[buf_count++] = { static_cast<ULONG>(min<size_t>(buffer.size(), numeric_limits<ULONG>::max())),
+                                   reinterpret_cast<CHAR*>(buffer.data()) };
+      }
+
+      // All buffers full
+      if (!buf_count)
+        break;
+
+      DWORD qtde = 0;
+      DWORD flags = 0;
+      if (WSARecv(m_winsocket, wsa_buf.data(), buf_count, &qtde, &flags, nullptr, nullptr) == SOCKET_ERROR)
+      {
+        auto erro = WSAGetLastError();
+
+        // No data to receive, but the connection is active
+        if (erro == WSAEWOULDBLOCK)
+          break;
+        else
+          throw nes_exc { "Error on socket data receive. Error: {}.", msg_err_str(erro) };
+      }
+      else if (qtde == 0)
+      {
+        // Closed socket, if there is data breaks
+        if (qtde_total > 0)
+          break;
+
+        throw socket_disconnected { "Socket closed normally." };
+      }
+
+      qtde_total += static_cast<size_t>(qtde);
+      offset += static_cast<size_t>(qtde);
+    }
+
+    return qtde_total;
+  }
+
+  bool win_socket::wait_readable(milliseconds time_expire)
+  {
+    return this->wait_events(POLLRDNORM, time_expire);
+  }
+
+  bool win_socket::wait_writable(milliseconds time_expire)
+  {
+    return this->wait_events(POLLWRNORM, time_expire);
+  }
+
+  bool win_socket::set_notsent_lowat(size_t)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot set the not sent low watermark." };
+
+    // No WinSock equivalent
+    return false;
+  }
+
+  bool win_socket::enable_zerocopy(size_t)
+  {
+    if (!this->is_connected())
+      throw nes_exc { "Socket is not connected, cannot enable the zero copy send." };
+
+    // No WinSock equivalent (the sends are always copied)
+    return false;
+  }
+
+  uint32_t win_socket::zerocopy_sent() const
+  {
+    return 0;
+  }
+
+  uint32_t win_socket::zerocopy_completed()
+  {
+    return 0;
+  }
+
+  uint32_t win_socket::zerocopy_copied() const
+  {
+    return 0;
+  }
+
+  bool win_socket::wait_zerocopy(milliseconds)
+  {
+    return true;
+  }
+
+  bool win_socket::wait_events(short events, milliseconds time_expire)
+  {
+    if (m_winsocket == INVALID_SOCKET)
+      throw nes_exc { "Socket is not configured, cannot wait data." };
+
+    WSAPOLLFD fd_sock {};
+    fd_sock.fd = m_winsocket;
+    fd_sock.events = events;
+
+    auto timeout_ms = static_cast<INT>(clamp<milliseconds::rep>(time_expire.count(), 0, numeric_limits<INT>::max()));
+    int ret = WSAPoll(&fd_sock, 1, timeout_ms);
+    if (ret == SOCKET_ERROR)
+      throw nes_exc { "Error on socket poll. Error: {}", msg_err_str(WSAGetLastError()) };
+
+    // Also ready on hangup/error, so the next receive reports it
+    return ret > 0;
+  }
+
   void WSA_init()
   {
     // Initialize on first instance
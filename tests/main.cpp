@@ -1,16 +1,29 @@
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <random>
 #include <thread>
+#include "buffer_pool.h"
 #include "byte_op.h"
 #include "nes_exc.h"
 #include "net_exc.h"
 #include "qtest.h"
+#include "shared_buffer.h"
 #include "socket.h"
 #include "socket_serv.h"
+#include "socket_util.h"
+#include "stream_reader.h"
+#include "tls_engine.h"
 #include "tls_socket.h"
 #include "tls_socket_serv.h"
+#ifndef _WIN32
+#include "reactor.h"
+#include "ring_buffer.h"
+#include "unix_uring.h"
+#endif
 using namespace std;
 using namespace std::chrono_literals;
 using namespace std::filesystem;
@@ -21,8 +34,14 @@ using namespace nes::test;
 void set_default_directory();
 
 // Tests
+void test__byte_op();
+void test__buffer_pool();
+void test__shared_buffer();
 void test__socket();
 void test__tls_socket();
+void test__reactor();
+void test__unix_uring();
+void test__ring_buffer();
 
 int main()
 try {
@@ -34,8 +53,16 @@ try {
 
     // Test entry points
     qtest::package("nes_sockets");
+    test__byte_op();
+    test__buffer_pool();
+    test__shared_buffer();
     test__socket();
     test__tls_socket();
+#ifndef _WIN32
+    test__reactor();
+    test__unix_uring();
+    test__ring_buffer();
+#endif
 
     qtest::print_summary(print_options::only_errors);
     //qtest::print_summary(print_options::all);
@@ -78,6 +105,130 @@ void set_default_directory()
         current_path().string() };
 }
 
+void test__byte_op()
+{
+    qtest::sub_package("nes::byte_op");
+    qtest::sub_package_title("bin_find");
+
+    {
+      // Many first byte candidates, to cross the vector blocks and the scalar tail
+      vector<byte> data(203, byte { 0xC0 });
+      const vector delim { byte { 0xC0 }, byte { 0x0A } };
+
+      qtest::eq(bin_find(data, delim), data.size());
+
+      data[150] = byte { 0x0A };
+      qtest::eq(bin_find(data, delim), size_t { 149 });
+      qtest::eq(bin_find(data, delim, 149), size_t { 149 });
+      qtest::eq(bin_find(data, delim, 150), data.size());
+
+      data.back() = byte { 0x0A };
+      qtest::eq(bin_find(data, delim, 150), size_t { 201 });
+      qtest::eq(bin_find(data, delim, data.size()), data.size());
+      qtest::eq(bin_find(data, delim, data.size() + 1), data.size());
+
+      qtest::eq(bin_find(strv_to_bin("abc\r\n\r\ndef"), strv_to_bin("\r\n\r\n")), size_t { 3 });
+      qtest::eq(bin_find(strv_to_bin("abc"), strv_to_bin("")), size_t { 0 });
+      qtest::eq(bin_find(strv_to_bin("ab"), strv_to_bin("abc")), size_t { 2 });
+    }
+}
+
+void test__buffer_pool()
+{
+    qtest::sub_package("nes::buffer_pool");
+    qtest::sub_package_title("size classes");
+
+    {
+      buffer_pool pool { 16 * 1024 };
+
+      // Released blocks are reused by the same class
+      auto p1 = pool.allocate(300);
+      pool.deallocate(p1, 300);
+      qtest::eq(pool.cached(), size_t { 512 });
+      qtest::eq(pool.allocate(500), p1);
+      qtest::eq(pool.cached(), size_t { 0 });
+      pool.deallocate(p1, 500);
+
+      // Over the cache limit goes back to the upstream
+      auto p2 = pool.allocate(16 * 1024);
+      auto p3 = pool.allocate(8 * 1024);
+      pool.deallocate(p2, 16 * 1024);
+      qtest::eq(pool.cached(), size_t { 512 });
+      pool.deallocate(p3, 8 * 1024);
+      qtest::eq(pool.cached(), size_t { 512 + 8 * 1024 });
+
+      // Bigger than the classes
+      auto p4 = pool.allocate(buffer_pool::max_block + 1);
+      pool.deallocate(p4, buffer_pool::max_block + 1);
+      qtest::eq(pool.cached(), size_t { 512 + 8 * 1024 });
+
+      pool.trim(1024);
+      qtest::eq(pool.cached(), size_t { 512 });
+      pool.trim();
+      qtest::eq(pool.cached(), size_t { 0 });
+    }
+
+    {
+      buffer_pool pool { buffer_pool::max_block, true };
+      qtest::is_true(pool.huge_pages());
+
+      pmr::vector<byte> data { &pool };
+      data.resize(buffer_pool::huge_page_size);
+      data.back() = byte { 0x7F };
+      qtest::eq(data.back(), byte { 0x7F });
+      data = pmr::vector<byte> { &pool };
+      qtest::eq(pool.cached(), buffer_pool::huge_page_size);
+    }
+
+    qtest::is_true(&buffer_pool::thread_local_pool() == &buffer_pool::thread_local_pool());
+}
+
+void test__shared_buffer()
+{
+    qtest::sub_package("nes::shared_buffer");
+    qtest::sub_package_title("slices and chain");
+
+    {
+      auto src = strv_to_bin("GET /a\nGET /b\n");
+      shared_buffer buf { vector<byte> { src.begin(), src.end() } };
+      qtest::eq(buf.size(), src.size());
+      qtest::eq(buf.use_count(), 1L);
+
+      // Slices share the storage
+      auto first = buf.slice(0, 7);
+      auto second = buf.slice(7);
+      qtest::eq(bin_to_strv(first), "GET /a\n");
+      qtest::eq(bin_to_strv(second), "GET /b\n");
+      qtest::is_true(second.data() == buf.data() + 7);
+      qtest::eq(buf.use_count(), 3L);
+      qtest::eq(bin_to_strv(second.slice(4, 100)), "/b\n");
+
+      try {
+        static_cast<void>(buf.slice(buf.size() + 1));
+        qtest::unreachable();
+      } catch (const nes_exc&) {
+        qtest::ok("buf.slice(); nes_exc ok");
+      }
+
+      // The storage outlives the original buffer
+      buf = shared_buffer {};
+      qtest::eq(first.use_count(), 2L);
+      qtest::eq(bin_to_strv(first), "GET /a\n");
+
+      buffer_chain chain { first, shared_buffer::copy_of(strv_to_bin("--")), second };
+      qtest::eq(chain.size(), size_t { 16 });
+      qtest::eq(chain.slices().size(), size_t { 3 });
+      qtest::eq(bin_to_str(chain.flatten()), "GET /a\n--GET /b\n");
+      qtest::eq(bin_to_str(chain.slice(5, 5).flatten()), "a\n--G");
+
+      chain.consume(8);
+      qtest::eq(chain.slices().size(), size_t { 2 });
+      qtest::eq(bin_to_str(chain.flatten()), "-GET /b\n");
+      chain.consume(chain.size());
+      qtest::is_true(chain.empty());
+    }
+}
+
 void test__socket()
 {
     qtest::sub_package("nes::net::socket[_serv]");
@@ -221,6 +372,215 @@ void test__socket()
 
         qtest::eq(data_recv.size(), 10'166 + tam);
 
+        // Readiness wait
+        qtest::is_false(c.wait_readable(0ms));
+        b.send("x");
+        qtest::is_true(c.wait_readable(1s));
+        qtest::eq(bin_to_strv(c.receive()), "x");
+
+        // Receive in caller buffer
+        array<byte, 4> recv_buffer {};
+        b.send("123456");
+        qtest::is_true(c.wait_readable(1s));
+        qtest::eq(c.receive_into(recv_buffer), size_t { 4 });
+        qtest::eq(bin_to_strv(recv_buffer), "1234");
+        qtest::eq(c.receive_into(recv_buffer), size_t { 2 });
+        qtest::eq(bin_to_strv(span { recv_buffer }.first(2)), "56");
+        qtest::eq(c.receive_into(recv_buffer), size_t { 0 });
+
+        // Gather send, header + body + trailer without concatenation
+        {
+          vector<byte> body(100'000, byte { 0x42 });
+          const array<span<const byte>, 4> parts { strv_to_bin("HDR:"), span<const byte> {}, body, strv_to_bin(":END") };
+          b.send(parts);
+          auto gathered = c.receive_until_size(body.size() + 8, 5s);
+          qtest::eq(bin_to_strv(span { gathered }.first(4)), "HDR:");
+          qtest::eq(bin_to_strv(span { gathered }.last(4)), ":END");
+          qtest::is_true(all_of(gathered.begin() + 4, gathered.end() - 4, [] (byte v) { return v == byte { 0x42 }; }));
+
+          // Many small buffers coalesced
+          vector<span<const byte>> small_parts(1'000, strv_to_bin("ab"));
+          qtest::eq(b.send(small_parts, 1s), size_t { 2'000 });
+          qtest::eq(c.receive_until_size(2'000, 5s).size(), size_t { 2'000 });
+        }
+
+        // Scatter receive, header and payload in separated buffers
+        {
+          array<byte, 2> header {};
+          array<byte, 6> payload {};
+          const array<span<byte>, 2> parts { header, payload };
+          b.send("H1payload");
+          qtest::is_true(c.wait_readable(1s));
+          this_thread::sleep_for(10ms);
+          qtest::eq(c.receive_into(parts), size_t { 8 });
+          qtest::eq(bin_to_strv(header), "H1");
+          qtest::eq(bin_to_strv(payload), "payloa");
+          qtest::eq(c.receive_into(parts), size_t { 1 });
+          qtest::eq(bin_to_strv(span { header }.first(1)), "d");
+        }
+
+        // Queued send, the peer does not read until the backpressure
+        {
+          if constexpr (!nes::cfg::so::is_windows)
+            qtest::is_true(b.set_notsent_lowat());
+          b.set_send_watermarks(64 * 1024, 256 * 1024);
+
+          vector<byte> chunk(64 * 1024, byte { 0x33 });
+          size_t queued_total = 0;
+          while (b.enqueue_send(chunk) && queued_total < 64 * 1024 * 1024)
+            queued_total += chunk.size();
+          queued_total += chunk.size();
+          qtest::is_true(b.send_blocked());
+          qtest::gteq(b.send_queued(), size_t { 256 * 1024 });
+
+          // Drain in the peer, flush on writable readiness
+          array<byte, 64 * 1024> drain;
+          size_t received = 0;
+          while (received < queued_total)
+          {
+            received += c.receive_into(drain);
+            if (b.send_queued() && b.wait_writable(0ms))
+              b.flush_send();
+            c.wait_readable(100ms);
+          }
+          qtest::eq(received, queued_total);
+          qtest::eq(b.send_queued(), size_t { 0 });
+          qtest::is_false(b.send_blocked());
+        }
+
+        // Zero copy send (the loopback copies anyway, but the completions are notified)
+        if (b.enable_zerocopy(64 * 1024))
+        {
+          vector<byte> snapshot(1024 * 1024, byte { 0x77 });
+          b.send(strv_to_bin("small"));
+          qtest::eq(b.zerocopy_sent(), uint32_t { 0 });
+          b.send(snapshot);
+          qtest::gteq(b.zerocopy_sent(), uint32_t { 1 });
+          qtest::eq(b.zerocopy_completed(), b.zerocopy_sent());
+
+          // The peer is not reading, so the timed send can be partial
+          auto timed_sent = b.send(snapshot, 100ms);
+          auto snapshot_recv = c.receive_until_size(5 + snapshot.size() + timed_sent, 5s);
+          qtest::is_true(b.wait_zerocopy(1s));
+          qtest::eq(b.zerocopy_completed(), b.zerocopy_sent());
+          qtest::eq(bin_to_strv(span { snapshot_recv }.first(5)), "small");
+        }
+        else
+          qtest::ok("zero copy send unavailable");
+
+        // File send
+        {
+          const auto file_path = temp_directory_path() / "nes_sockets_send_file.bin";
+          vector<byte> file_data(300'000);
+          for (size_t i = 0; i < file_data.size(); ++i)
+            file_data[i] = static_cast<byte>(i % 251);
+          {
+            ofstream file { file_path, ios::binary };
+            file.write(reinterpret_cast<const char*>(file_data.data()), static_cast<streamsize>(file_data.size()));
+          }
+
+          b.send_file(file_path, 10, 100);
+          auto file_recv = c.receive_until_size(100, 1s);
+          qtest::is_true(equal(file_recv.begin(), file_recv.end(), file_data.begin() + 10));
+
+          // Whole file (length truncated) with the receiver draining in parallel
+          thread file_sender { [&] { b.send_file(file_path); } };
+          file_recv = c.receive_until_size(file_data.size(), 5s);
+          file_sender.join();
+          qtest::is_true(file_recv == file_data);
+
+          qtest::eq(b.send_file(file_path, file_data.size(), 10, 1s), uint64_t { 0 });
+          remove(file_path);
+        }
+
+        // Caller buffer utilities
+        array<byte, 16> frame {};
+        b.send("ab\r\ncd");
+        auto [frame_size, delim_pos] = c.receive_until_delimiter(frame, strv_to_bin("\r\n"), 1s);
+        qtest::eq(delim_pos, size_t { 2 });
+        c.receive_until_size(span { frame }.subspan(frame_size, 6 - frame_size), 1s);
+        qtest::eq(bin_to_strv(span { frame }.first(6)), "ab\r\ncd");
+
+        b.send("12345678");
+        c.receive_until_size(span { frame }.first(8), 1s);
+        qtest::eq(bin_to_strv(span { frame }.first(8)), "12345678");
+
+        b.send("xyz");
+        qtest::eq(c.receive_at_least(frame, 3, 1s), size_t { 3 });
+        qtest::eq(bin_to_strv(span { frame }.first(3)), "xyz");
+
+        b.send("abcd");
+        vector<byte> partial { byte { 'a' } };
+        c.receive_remaining(partial, 5, 1s);
+        qtest::eq(bin_to_strv(partial), "aabcd");
+
+        // Buffered reader, pipelined messages in one receive
+        stream_reader rd(c);
+        b.send("GET a\r\nGET b\r\n\x03xyzw");
+        qtest::eq(bin_to_strv(rd.read_until(strv_to_bin("\r\n"), 1s, 64)), "GET a\r\n");
+        qtest::eq(bin_to_strv(rd.read_until(strv_to_bin("\r\n"), 1s, 64)), "GET b\r\n");
+        auto frame_len = rd.read_exact(1, 1s);
+        qtest::eq(rd.buffered(), size_t { 4 });
+        qtest::eq(bin_to_strv(rd.read_exact(to_integer<size_t>(frame_len.at(0)), 1s)), "xyz");
+        qtest::eq(bin_to_strv(rd.read_some()), "w");
+        qtest::eq(rd.read_some(frame), size_t { 0 });
+
+        b.send("12");
+        this_thread::sleep_for(10ms);
+        b.send("34");
+        rd.read_exact(span { frame }.first(4), 1s);
+        qtest::eq(bin_to_strv(span { frame }.first(4)), "1234");
+
+        // Receive in pool buffers
+        auto& pool = buffer_pool::thread_local_pool();
+        b.send("pool");
+        this_thread::sleep_for(10ms);
+        auto pool_recv = c.receive(&pool);
+        qtest::eq(bin_to_strv(pool_recv), "pool");
+        qtest::is_true(pool_recv.get_allocator().resource() == &pool);
+
+        b.send("a;b;");
+        auto [pool_msg, pool_pos] = receive_until_delimiter(c, strv_to_bin(";b;"), 1s, 64, &pool);
+        qtest::eq(pool_pos, size_t { 1 });
+        b.send("12345");
+        auto pool_sized = receive_until_size(c, 5, 1s, &pool);
+        qtest::eq(bin_to_strv(pool_sized), "12345");
+        qtest::eq(pool_sized.capacity(), size_t { 5 });
+        b.send("67");
+        qtest::eq(bin_to_strv(receive_at_least(c, 1, 1s, &pool)), "67");
+
+        // Surplus of the exact size is left to the next receive
+        b.send("abcdef");
+        this_thread::sleep_for(10ms);
+        qtest::eq(bin_to_strv(c.receive_until_size(4, 1s)), "abcd");
+        qtest::eq(bin_to_strv(c.receive_until_size(2, 1s)), "ef");
+
+        // No maximum size
+        b.send("no max;");
+        auto [nomax_msg, nomax_pos] = c.receive_until_delimiter(strv_to_bin(";"), 1s, numeric_limits<size_t>::max());
+        qtest::eq(nomax_pos, size_t { 6 });
+
+        // Shared buffers, forward a slice of the received data
+        c.send(buffer_chain { shared_buffer::copy_of(strv_to_bin("ab")), shared_buffer::copy_of(strv_to_bin("cd")) });
+        buffer_chain shared_recv;
+        while (shared_recv.size() < 4 && b.wait_readable(1s))
+          shared_recv.append(b.receive_shared());
+        qtest::eq(bin_to_str(shared_recv.flatten()), "abcd");
+        c.send(shared_recv.slice(2));
+        qtest::eq(bin_to_strv(b.receive_until_size(2, 1s)), "cd");
+
+        // Deadline send, the peer does not read so the socket buffers fill up
+        qtest::is_true(c.wait_writable(1s));
+        vector<byte> big_data(64 * 1024 * 1024, byte { 0x5A });
+        auto sent = c.send(big_data, 50ms);
+        qtest::gt(sent, size_t { 0 });
+        qtest::lt(sent, big_data.size());
+        qtest::is_false(c.wait_writable(0ms));
+
+        // Read what was sent so the communication keeps in sync
+        auto excess = b.receive_until_size(sent, 5s);
+        qtest::eq(excess.size(), sent);
+
         // Test fail receive
         try {
           data_recv = c.receive_until_size(1, 50ms);
@@ -231,8 +591,14 @@ void test__socket()
           qtest::unreachable();
         }
 
+        // Exact packets and then the close, the data is returned and the error left to the next receive
+        c.send(vector<byte>(2 * cfg::net::packet_size, byte { 0x33 }));
+        this_thread::sleep_for(10ms);
+
         // Test desconection
         { auto d = move(c); (void)d; }
+        this_thread::sleep_for(10ms);
+        qtest::eq(b.receive(&pool).size(), 2 * cfg::net::packet_size);
         try {
           data_recv = b.receive();
           qtest::unreachable();
@@ -415,6 +781,47 @@ void test__tls_socket()
 
         qtest::eq(dados_rec.size(), 10'166 + tam);
 
+        // Receive in caller buffer
+        array<byte, 4> recv_buffer {};
+        b.send("123456");
+        qtest::is_true(c.wait_readable(1s));
+        qtest::eq(c.receive_into(recv_buffer), size_t { 4 });
+        qtest::eq(bin_to_strv(recv_buffer), "1234");
+        qtest::eq(c.receive_into(recv_buffer), size_t { 2 });
+        qtest::eq(bin_to_strv(span { recv_buffer }.first(2)), "56");
+        qtest::eq(c.receive_into(recv_buffer), size_t { 0 });
+
+        // Gather send, header + body + trailer without concatenation
+        {
+          vector<byte> body(100'000, byte { 0x42 });
+          const array<span<const byte>, 4> parts { strv_to_bin("HDR:"), span<const byte> {}, body, strv_to_bin(":END") };
+          b.send(parts);
+          auto gathered = c.receive_until_size(body.size() + 8, 5s);
+          qtest::eq(bin_to_strv(span { gathered }.first(4)), "HDR:");
+          qtest::eq(bin_to_strv(span { gathered }.last(4)), ":END");
+          qtest::is_true(all_of(gathered.begin() + 4, gathered.end() - 4, [] (byte v) { return v == byte { 0x42 }; }));
+
+          // Many small buffers coalesced
+          vector<span<const byte>> small_parts(1'000, strv_to_bin("ab"));
+          qtest::eq(b.send(small_parts, 1s), size_t { 2'000 });
+          qtest::eq(c.receive_until_size(2'000, 5s).size(), size_t { 2'000 });
+        }
+
+        // Scatter receive, header and payload in separated buffers
+        {
+          array<byte, 2> header {};
+          array<byte, 6> payload {};
+          const array<span<byte>, 2> parts { header, payload };
+          b.send("H1payload");
+          qtest::is_true(c.wait_readable(1s));
+          this_thread::sleep_for(10ms);
+          qtest::eq(c.receive_into(parts), size_t { 8 });
+          qtest::eq(bin_to_strv(header), "H1");
+          qtest::eq(bin_to_strv(payload), "payloa");
+          qtest::eq(c.receive_into(parts), size_t { 1 });
+          qtest::eq(bin_to_strv(span { header }.first(1)), "d");
+        }
+
         // Test fail receive
         try {
           dados_rec = c.receive_until_size(1, 50ms);
@@ -440,4 +847,825 @@ void test__tls_socket()
         }
       }
     }
+
+    qtest::sub_package_title("kernel TLS");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(52733, 53232);
+      unsigned port_ran { port_distrib(gen) };
+
+      tls_socket_serv a;
+      try {
+        a = tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem" };
+      } catch (...) { qtest::unreachable(); }
+      a.enable_ktls();
+      qtest::is_true(a.ktls_enabled());
+
+      tls_socket b { "127.0.0.1", port_ran };
+      this_thread::sleep_for(50ms);
+
+      optional<tls_socket> oc;
+      try { oc = a.accept(); } catch (...) { qtest::unreachable(); }
+      qtest::is_true(oc);
+      if (oc)
+      {
+        auto c = move(*oc);
+
+        // Requested before the handshake, active only with kernel support (fallback to OpenSSL records)
+        b.enable_ktls();
+        same_thread_handshake(c, b);
+        qtest::is_false(b.enable_ktls());
+        if (b.ktls_send())
+          qtest::ok("kernel TLS send active");
+        else
+          qtest::ok("kernel TLS unavailable, OpenSSL records");
+
+        b.send("abcd");
+        qtest::eq(bin_to_strv(c.receive_until_size(4, 1s)), "abcd");
+        c.send("1234");
+        qtest::eq(bin_to_strv(b.receive_until_size(4, 1s)), "1234");
+
+        // File send, SSL_sendfile with kernel TLS
+        const auto file_path = temp_directory_path() / "nes_sockets_tls_send_file.bin";
+        vector<byte> file_data(200'000);
+        for (size_t i = 0; i < file_data.size(); ++i)
+          file_data[i] = static_cast<byte>(i % 253);
+        {
+          ofstream file { file_path, ios::binary };
+          file.write(reinterpret_cast<const char*>(file_data.data()), static_cast<streamsize>(file_data.size()));
+        }
+
+        b.send_file(file_path, 20, 1'000);
+        auto file_recv = c.receive_until_size(1'000, 1s);
+        qtest::is_true(equal(file_recv.begin(), file_recv.end(), file_data.begin() + 20));
+
+        thread file_sender { [&] { b.send_file(file_path); } };
+        file_recv = c.receive_until_size(file_data.size(), 5s);
+        file_sender.join();
+        qtest::is_true(file_recv == file_data);
+
+        qtest::eq(b.send_file(file_path, file_data.size(), 10, 1s), uint64_t { 0 });
+        remove(file_path);
+      }
+    }
+
+    qtest::sub_package_title("client session resumption");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(53233, 53732);
+      unsigned port_ran { port_distrib(gen) };
+
+      tls_socket_serv a;
+      try {
+        a = tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem" };
+      } catch (...) { qtest::unreachable(); }
+      tls_socket::clear_session_cache();
+
+      // Full handshake, then resumed ones (the session ticket is received with the data)
+      auto reconnect = [&] (string_view host_name, string host = "127.0.0.1") {
+        tls_socket b { move(host), port_ran };
+        if (!host_name.empty())
+          b.tls_ext_host_name(string { host_name });
+        this_thread::sleep_for(50ms);
+
+        auto oc = a.accept();
+        if (!oc)
+          return optional<bool> {};
+
+        auto c = move(*oc);
+        same_thread_handshake(c, b);
+        c.send("ping");
+        if (bin_to_strv(b.receive_until_size(4, 1s)) != "ping")
+          return optional<bool> {};
+
+        return optional { b.session_reused() };
+      };
+
+      qtest::eq(reconnect(""), optional { false });
+      qtest::eq(reconnect(""), optional { true });
+      qtest::eq(reconnect(""), optional { true });
+
+      // The virtual host has its own session
+      qtest::eq(reconnect("localhost"), optional { false });
+      qtest::eq(reconnect("localhost"), optional { true });
+
+      // The key is the host of the connect, not the resolved address
+      qtest::eq(reconnect("", "localhost"), optional { false });
+      qtest::eq(reconnect("", "localhost"), optional { true });
+
+      tls_socket::clear_session_cache();
+      qtest::eq(reconnect(""), optional { false });
+    }
+
+    qtest::sub_package_title("server session cache and ticket keys");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(53733, 54232);
+      unsigned port_ran { port_distrib(gen) };
+
+      auto listen = [&] {
+        return tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem" };
+      };
+
+      // The client closes first, the server port is free to listen again
+      auto reconnect = [&] (tls_socket_serv& serv) {
+        tls_socket b { "127.0.0.1", port_ran };
+        this_thread::sleep_for(50ms);
+
+        auto oc = serv.accept();
+        if (!oc)
+          return optional<bool> {};
+
+        auto c = move(*oc);
+        same_thread_handshake(c, b);
+        c.send("ping");
+        if (bin_to_strv(b.receive_until_size(4, 1s)) != "ping")
+          return optional<bool> {};
+
+        auto reused = b.session_reused();
+        b.disconnect();
+        return optional { reused };
+      };
+
+      tls_socket::clear_session_cache();
+      shared_ptr<tls_ticket_keys> keys;
+      try {
+        auto a = listen();
+        a.set_session_cache(1'024, 60s);
+        keys = a.ticket_keys();
+        qtest::eq(keys->size(), size_t { 1 });
+
+        qtest::eq(reconnect(a), optional { false });
+        qtest::eq(reconnect(a), optional { true });
+        qtest::eq(a.session_hits(), uint64_t { 1 });
+        qtest::eq(a.session_misses(), uint64_t { 1 });
+
+        // Ticket of the previous key is accepted (and renewed)
+        keys->rotate();
+        qtest::eq(keys->size(), size_t { 2 });
+        qtest::eq(reconnect(a), optional { true });
+
+        // Dropped key, full handshake
+        keys->rotate();
+        keys->rotate();
+        qtest::eq(reconnect(a), optional { false });
+        qtest::eq(a.session_hits(), uint64_t { 2 });
+        qtest::eq(a.session_misses(), uint64_t { 2 });
+      } catch (...) { qtest::unreachable(); }
+
+      // Other listener with the same keys resumes the sessions
+      try {
+        auto a = listen();
+        a.set_ticket_keys(keys);
+        qtest::eq(reconnect(a), optional { true });
+        qtest::eq(a.session_hits(), uint64_t { 1 });
+      } catch (...) { qtest::unreachable(); }
+
+      try {
+        auto a = listen();
+        qtest::eq(reconnect(a), optional { false });
+        qtest::eq(a.session_misses(), uint64_t { 1 });
+      } catch (...) { qtest::unreachable(); }
+    }
+
+    qtest::sub_package_title("TLS context");
+
+    {
+      // Copies share the OpenSSL context
+      tls_context serv_ctx { tls_context::role::server };
+      tls_context copy_ctx { serv_ctx };
+      qtest::is_true(copy_ctx.native_handle() == serv_ctx.native_handle());
+      qtest::is_true(copy_ctx.context_role() == tls_context::role::server);
+      qtest::is_true(tls_context::client().native_handle() != tls_context::thread_client().native_handle());
+
+      tls_context moved_ctx { move(copy_ctx) };
+      qtest::is_true(copy_ctx.native_handle() == nullptr);
+      qtest::is_true(moved_ctx.native_handle() == serv_ctx.native_handle());
+
+      try {
+        tls_context { tls_context::role::client }.use_certificate("../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem");
+        qtest::unreachable();
+      } catch (const nes_exc&) {
+        qtest::ok("use_certificate() in a client context; nes_exc ok");
+      } catch (...) {
+        qtest::unreachable();
+      }
+
+      // Two listeners in the same server context, clients in the thread context
+      uniform_int_distribution<unsigned> port_distrib(54233, 54732);
+      unsigned port_ran { port_distrib(gen) };
+
+      tls_socket_serv a, b;
+      try {
+        a = tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem", serv_ctx };
+        b = tls_socket_serv { port_ran + 1, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem", serv_ctx };
+      } catch (...) { qtest::unreachable(); }
+      qtest::is_true(a.context().native_handle() == b.context().native_handle());
+
+      for (auto p_serv : { &a, &b })
+      {
+        tls_socket c { "127.0.0.1", p_serv->ipv4_port(), tls_context::thread_client() };
+        this_thread::sleep_for(50ms);
+
+        auto oc = p_serv->accept();
+        qtest::is_true(oc);
+        if (oc)
+        {
+          same_thread_handshake(*oc, c);
+          oc->send("ctx");
+          qtest::eq(bin_to_strv(c.receive_until_size(3, 1s)), "ctx");
+        }
+      }
+
+      // The server context does not connect
+      try {
+        tls_socket c { "127.0.0.1", port_ran, serv_ctx };
+        qtest::unreachable();
+      } catch (const nes_exc&) {
+        qtest::ok("tls_socket{ server context }; nes_exc ok");
+      } catch (...) {
+        qtest::unreachable();
+      }
+    }
+
+    qtest::sub_package_title("stepwise handshake");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(54733, 55232);
+      unsigned port_ran { port_distrib(gen) };
+
+      tls_socket_serv a;
+      try {
+        a = tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem" };
+      } catch (...) { qtest::unreachable(); }
+
+      tls_socket b { "127.0.0.1", port_ran };
+      this_thread::sleep_for(50ms);
+
+      optional<tls_socket> oc;
+      try { oc = a.accept(); } catch (...) { qtest::unreachable(); }
+      qtest::is_true(oc);
+      if (oc)
+      {
+        auto c = move(*oc);
+        qtest::is_false(b.handshake_done());
+
+        // Client hello, then each side waits the other flight
+        qtest::is_true(b.handshake_step() == tls_socket::handshake_status::want_read);
+        qtest::is_true(c.wait_readable(1s));
+        qtest::is_true(c.handshake_step() == tls_socket::handshake_status::want_read);
+        qtest::is_true(b.wait_readable(1s));
+        qtest::is_true(b.handshake_step() == tls_socket::handshake_status::done);
+        qtest::is_true(c.wait_readable(1s));
+        qtest::is_true(c.handshake_step() == tls_socket::handshake_status::done);
+
+        qtest::is_true(b.handshake_done() && c.handshake_done());
+        qtest::is_true(b.handshake_step() == tls_socket::handshake_status::done);
+
+        b.send("step");
+        qtest::eq(bin_to_strv(c.receive_until_size(4, 1s)), "step");
+      }
+    }
+
+    qtest::sub_package_title("handshake workers");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(55233, 55732);
+      unsigned port_ran { port_distrib(gen) };
+
+      tls_socket_serv a;
+      try {
+        a = tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem" };
+      } catch (...) { qtest::unreachable(); }
+
+      try {
+        a.accept_established();
+        qtest::unreachable();
+      } catch (const nes_exc&) {
+        qtest::ok("a.accept_established() without workers; nes_exc ok");
+      } catch (...) {
+        qtest::unreachable();
+      }
+
+      a.start_handshake_workers(2, 2);
+      qtest::is_false(a.accept_established().has_value());
+
+      // Only two in handshake, the third waits in the backlog
+      tls_socket b1 { "127.0.0.1", port_ran };
+      tls_socket b2 { "127.0.0.1", port_ran };
+      tls_socket b3 { "127.0.0.1", port_ran };
+      this_thread::sleep_for(50ms);
+      qtest::is_false(a.accept_established().has_value());
+      qtest::eq(a.handshakes_in_flight(), size_t { 2 });
+
+      // The client side handshake in this thread, the server side in the workers
+      b1.send("b1");
+      b2.send("b2");
+      vector<string> received;
+      for (int i = 0; i < 2; ++i)
+        if (auto c = a.accept_established(1s); c)
+        {
+          qtest::is_true(c->handshake_done());
+          received.emplace_back(bin_to_strv(c->receive_until_size(2, 1s)));
+        }
+      sort(received.begin(), received.end());
+      qtest::is_true(received == vector<string> { "b1", "b2" });
+
+      qtest::is_false(a.accept_established().has_value());
+      qtest::eq(a.handshakes_in_flight(), size_t { 1 });
+      b3.send("b3");
+      auto c3 = a.accept_established(1s);
+      qtest::is_true(c3);
+      if (c3)
+        qtest::eq(bin_to_strv(c3->receive_until_size(2, 1s)), "b3");
+      qtest::eq(a.handshakes_in_flight(), size_t { 0 });
+
+      // Not TLS client
+      socket d { "127.0.0.1", port_ran };
+      this_thread::sleep_for(50ms);
+      qtest::is_false(a.accept_established().has_value());
+      d.send("not a TLS hello\r\n\r\n");
+      qtest::is_false(a.accept_established(200ms).has_value());
+      qtest::eq(a.handshakes_failed(), uint64_t { 1 });
+
+      a.stop_handshake_workers();
+      qtest::eq(a.handshakes_in_flight(), size_t { 0 });
+    }
+
+    qtest::sub_package_title("dynamic record size");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(55733, 56232);
+      unsigned port_ran { port_distrib(gen) };
+
+      tls_socket_serv a;
+      try {
+        a = tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem" };
+      } catch (...) { qtest::unreachable(); }
+
+      tls_socket b { "127.0.0.1", port_ran };
+      this_thread::sleep_for(50ms);
+
+      optional<tls_socket> oc;
+      try { oc = a.accept(); } catch (...) { qtest::unreachable(); }
+      qtest::is_true(oc);
+      if (oc)
+      {
+        auto c = move(*oc);
+        same_thread_handshake(c, b);
+
+        // Small records at the start, full after the threshold
+        qtest::eq(b.record_size(), cfg::net::tls_small_record_size);
+        vector<byte> bulk(cfg::net::tls_dynamic_record_threshold + 100'000);
+        for (size_t i = 0; i < bulk.size(); ++i)
+          bulk[i] = static_cast<byte>(i % 241);
+
+        thread sender { [&] { b.send(bulk); } };
+        auto bulk_recv = c.receive_until_size(bulk.size(), 5s);
+        sender.join();
+        qtest::is_true(bulk_recv == bulk);
+        qtest::eq(b.record_size(), cfg::net::tls_record_size);
+
+        b.set_dynamic_records(false);
+        qtest::eq(b.record_size(), cfg::net::tls_record_size);
+        b.set_dynamic_records();
+
+        // Small again after idle
+        this_thread::sleep_for(cfg::net::tls_dynamic_record_idle + 50ms);
+        qtest::eq(b.record_size(), cfg::net::tls_small_record_size);
+        b.send("after idle");
+        qtest::eq(bin_to_strv(c.receive_until_size(10, 1s)), "after idle");
+        qtest::eq(b.record_size(), cfg::net::tls_small_record_size);
+      }
+    }
+
+    qtest::sub_package_title("read ahead and pending");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(56233, 56732);
+      unsigned port_ran { port_distrib(gen) };
+
+      tls_socket_serv a;
+      try {
+        a = tls_socket_serv { port_ran, "../examples/expired-localhost-public.pem",
+          "../examples/expired-localhost-private.pem" };
+      } catch (...) { qtest::unreachable(); }
+
+      tls_socket b { "127.0.0.1", port_ran };
+      this_thread::sleep_for(50ms);
+
+      optional<tls_socket> oc;
+      try { oc = a.accept(); } catch (...) { qtest::unreachable(); }
+      qtest::is_true(oc);
+      if (oc)
+      {
+        auto c = move(*oc);
+        c.set_read_ahead(128 * 1'024);
+        same_thread_handshake(c, b);
+        qtest::eq(c.pending(), size_t { 0 });
+        qtest::is_false(c.has_pending());
+
+        // Rest of the record decrypted
+        b.send("0123456789");
+        qtest::is_true(c.wait_readable(1s));
+        this_thread::sleep_for(10ms);
+        array<byte, 4> small {};
+        qtest::eq(c.receive_into(small), size_t { 4 });
+        qtest::eq(c.pending(), size_t { 6 });
+        qtest::is_true(c.has_pending());
+        qtest::is_true(c.wait_readable(0ms));
+        qtest::eq(bin_to_strv(c.receive()), "456789");
+
+        // Many records read from the socket at once, the next ones buffered not decrypted
+        b.send("r1");
+        b.send("r2");
+        b.send("r3");
+        this_thread::sleep_for(50ms);
+        array<byte, 2> record {};
+        qtest::eq(c.receive_into(record), size_t { 2 });
+        qtest::eq(bin_to_strv(record), "r1");
+        qtest::is_true(c.has_pending());
+        qtest::is_true(c.wait_readable(0ms));
+        qtest::eq(bin_to_strv(c.receive()), "r2r3");
+        qtest::is_false(c.has_pending());
+
+        c.set_read_ahead(0);
+        b.send("no read ahead");
+        qtest::eq(bin_to_strv(c.receive_until_size(13, 1s)), "no read ahead");
+      }
+    }
+
+    qtest::sub_package_title("partial record wait");
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(56733, 57232);
+      unsigned port_ran { port_distrib(gen) };
+
+      // The peer is a tls_engine over a plain socket, so the ciphertext can be cut
+      socket_serv a(port_ran);
+      tls_socket b { "127.0.0.1", port_ran };
+      this_thread::sleep_for(50ms);
+
+      auto oc = a.accept();
+      qtest::is_true(oc);
+      if (oc)
+      {
+        auto c = move(*oc);
+        tls_context serv_ctx { tls_context::role::server };
+        serv_ctx.use_certificate("../examples/expired-localhost-public.pem", "../examples/expired-localhost-private.pem");
+        tls_engine e { serv_ctx };
+
+        array<byte, 16 * 1'024> cipher_in {};
+        for (int i = 0; i < 20 && !(b.handshake_done() && e.handshake_done()); ++i)
+        {
+          b.handshake_step();
+          if (c.wait_readable(100ms))
+            e.feed(span { cipher_in }.first(c.receive_into(cipher_in)));
+          e.handshake();
+          if (auto out = e.take_output(); !out.empty())
+            c.send(out);
+        }
+        qtest::is_true(b.handshake_done());
+        qtest::is_true(e.handshake_done());
+
+        // Record without the tail, buffered in the client with nothing to decrypt
+        e.write(strv_to_bin("partial record"));
+        auto record = e.take_output();
+        c.send(span { record }.first(record.size() - 5));
+        qtest::is_true(b.wait_readable(1s));
+        this_thread::sleep_for(10ms);
+        array<byte, 32> plain {};
+        qtest::eq(b.receive_into(plain), size_t { 0 });
+        qtest::is_true(b.has_pending());
+        qtest::eq(b.pending(), size_t { 0 });
+
+        // Waits the socket for the rest (no busy spin)
+        auto start = chrono::steady_clock::now();
+        qtest::is_false(b.wait_readable(50ms));
+        qtest::is_true(chrono::steady_clock::now() - start >= 40ms);
+
+        c.send(span { record }.last(5));
+        qtest::is_true(b.wait_readable(1s));
+        qtest::eq(bin_to_strv(b.receive_until_size(14, 1s)), "partial record");
+      }
+    }
+
+    qtest::sub_package_title("memory TLS engine");
+
+    {
+      tls_context serv_ctx { tls_context::role::server };
+      serv_ctx.use_certificate("../examples/expired-localhost-public.pem", "../examples/expired-localhost-private.pem");
+
+      tls_engine cli { tls_context::client() };
+      tls_engine serv { serv_ctx };
+
+      // In memory transport, the output of one engine is the input of the other
+      auto pump = [] (tls_engine& from, tls_engine& to) {
+        auto cipher_data = from.take_output();
+        span<const byte> rest { cipher_data };
+        while (!rest.empty())
+        {
+          auto qtde = to.feed(rest);
+          if (!qtde)
+            break;
+          rest = rest.subspan(qtde);
+        }
+        return cipher_data.size() - rest.size();
+      };
+
+      cli.tls_ext_host_name("localhost");
+      for (int i = 0; i < 10 && !(cli.handshake_done() && serv.handshake_done()); ++i)
+      {
+        cli.handshake();
+        pump(cli, serv);
+        serv.handshake();
+        pump(serv, cli);
+      }
+      qtest::is_true(cli.handshake_done());
+      qtest::is_true(serv.handshake_done());
+      qtest::eq(cli.cipher(), serv.cipher());
+      qtest::eq(cli.tls_protocol(), serv.tls_protocol());
+
+      // Plaintext through the engines without the kernel
+      qtest::eq(cli.write(strv_to_bin("hello engine")), size_t { 12 });
+      qtest::gt(cli.output_size(), size_t { 12 });
+      pump(cli, serv);
+      array<byte, 32> plain {};
+      auto qtde = serv.read(plain);
+      qtest::eq(bin_to_strv(span { plain }.first(qtde)), "hello engine");
+      qtest::eq(serv.read(plain), size_t { 0 });
+
+      // Bulk, limited by the engine buffers (partial writes)
+      vector<byte> bulk(1'000'000);
+      for (size_t i = 0; i < bulk.size(); ++i)
+        bulk[i] = static_cast<byte>(i % 239);
+
+      vector<byte> bulk_recv;
+      span<const byte> to_write { bulk };
+      vector<byte> chunk(64 * 1'024);
+      for (int i = 0; i < 10'000 && bulk_recv.size() < bulk.size(); ++i)
+      {
+        auto written = to_write.empty() ? size_t { 0 } : serv.write(to_write);
+        to_write = to_write.subspan(written);
+        pump(serv, cli);
+        while (auto n = cli.read(chunk))
+          bulk_recv.insert(bulk_recv.end(), chunk.begin(), chunk.begin() + static_cast<ptrdiff_t>(n));
+      }
+      qtest::is_true(bulk_recv == bulk);
+
+      // Close
+      qtest::is_false(serv.is_closed());
+      cli.shutdown();
+      pump(cli, serv);
+      qtest::eq(serv.read(plain), size_t { 0 });
+      qtest::is_true(serv.is_closed());
+
+      // Not TLS input
+      tls_engine bad { serv_ctx };
+      bad.feed(strv_to_bin("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+      try {
+        bad.handshake();
+        qtest::unreachable();
+      } catch (const nes_exc&) {
+        qtest::ok("bad.handshake(); nes_exc ok");
+      } catch (...) {
+        qtest::unreachable();
+      }
+    }
+}
+
+#ifndef _WIN32
+void test__reactor()
+{
+    qtest::sub_package("nes::net::reactor");
+    qtest::sub_package_title("accept and readable dispatch");
+
+    random_device rd;
+    mt19937 gen(rd());
+
+    {
+      uniform_int_distribution<unsigned> port_distrib(51233, 51732);
+      unsigned port_ran { port_distrib(gen) };
+
+      reactor r;
+      socket_serv a(port_ran);
+
+      vector<socket> clients;
+      r.add(a, [&](socket s) { clients.push_back(move(s)); });
+      qtest::is_true(r.contains(a.native_handle()));
+      qtest::eq(r.run_once(0ms), size_t { 0 });
+
+      socket b("127.0.0.1", port_ran);
+      socket b2("127.0.0.1", port_ran);
+
+      // One readiness event delivers both clients
+      qtest::eq(r.run_once(1s), size_t { 1 });
+      qtest::eq(clients.size(), size_t { 2 });
+
+      if (clients.size() == 2)
+      {
+        vector<byte> data_recv;
+        io_event last_event = io_event::none;
+        bool disconnected = false;
+        r.add(clients[0], io_event::readable, [&](io_event ev) {
+          last_event = ev;
+          try {
+            const auto data = clients[0].receive();
+            data_recv.insert(data_recv.end(), data.begin(), data.end());
+          } catch (const socket_disconnected&) {
+            disconnected = true;
+          }
+        });
+
+        b.send("abcd");
+        qtest::eq(r.run_once(1s), size_t { 1 });
+        qtest::is_true(has_event(last_event, io_event::readable));
+        qtest::eq(bin_to_strv(data_recv), "abcd");
+
+        // Drained, so no new event until more data
+        qtest::eq(r.run_once(50ms), size_t { 0 });
+
+        b.disconnect();
+        qtest::eq(r.run_once(1s), size_t { 1 });
+        qtest::is_true(has_event(last_event, io_event::closed));
+        qtest::is_true(disconnected);
+
+        r.remove(clients[0]);
+        qtest::is_false(r.contains(clients[0].native_handle()));
+        qtest::eq(r.size(), size_t { 1 });
+      }
+    }
+}
+
+void test__unix_uring()
+{
+    using nes::so::unix_socket;
+    using nes::so::unix_uring;
+
+    qtest::sub_package("nes::so::unix_uring");
+    qtest::sub_package_title("batched accept/connect/send/receive");
+
+    random_device rd;
+    mt19937 gen(rd());
+
+    optional<unix_uring> ring;
+    try {
+      ring.emplace(32);
+    } catch (const nes_exc& e) {
+      // Kernel without io_uring (or blocked), nothing to test
+      qtest::ok(string { "io_uring unavailable: " } + e.what());
+      return;
+    }
+
+    uniform_int_distribution<unsigned> port_distrib(51733, 52232);
+    unsigned port_ran { port_distrib(gen) };
+
+    unix_socket serv;
+    serv.listen(port_ran);
+
+    unix_socket cli;
+    qtest::is_true(ring->queue_accept(serv, 1));
+    qtest::is_true(ring->queue_connect(cli, "127.0.0.1", port_ran, 2));
+    qtest::eq(ring->queued(), size_t { 2 });
+
+    // One enter for both operations
+    vector<unix_uring::completion> completions;
+    qtest::eq(ring->submit(2), size_t { 2 });
+    while (completions.size() < 2)
+    {
+      ring->reap(completions);
+      if (completions.size() < 2)
+        ring->submit(1);
+    }
+
+    optional<unix_socket> acc;
+    for (auto& c : completions)
+    {
+      qtest::eq(c.result, 0);
+      if (c.op == unix_uring::operation::accept)
+        acc = move(c.accepted);
+    }
+    qtest::is_true(cli.is_connected());
+    qtest::is_true(acc.has_value());
+
+    if (acc)
+    {
+      completions.clear();
+      array<byte, 16> buffer {};
+      const auto data = strv_to_bin("abcd");
+      qtest::is_true(ring->queue_receive(*acc, buffer, 3));
+      qtest::is_true(ring->queue_send(cli, data, 4));
+      ring->submit(2);
+      while (completions.size() < 2)
+      {
+        ring->reap(completions);
+        if (completions.size() < 2)
+          ring->submit(1);
+      }
+
+      for (const auto& c : completions)
+      {
+        qtest::eq(c.result, 4);
+        if (c.user_data == 3)
+          qtest::eq(bin_to_strv(span { buffer }.first(4)), "abcd");
+      }
+      qtest::eq(ring->in_flight(), size_t { 0 });
+
+      // Release with operations in flight, they are canceled before the op data is freed
+      qtest::is_true(ring->queue_accept(serv, 5));
+      qtest::is_true(ring->queue_receive(*acc, buffer, 6));
+      ring->submit();
+      qtest::eq(ring->in_flight(), size_t { 2 });
+      ring.reset();
+
+      // The canceled receive took nothing
+      cli.send(strv_to_bin("after"));
+      qtest::is_true(acc->wait_readable(1s));
+      qtest::eq(bin_to_strv(acc->receive()), "after");
+    }
+}
+
+void test__ring_buffer()
+{
+    qtest::sub_package("nes::ring_buffer");
+    qtest::sub_package_title("mirrored mapping");
+
+    // Page rounded
+    ring_buffer ring { 100 };
+    qtest::is_true(ring.capacity() >= 100);
+    qtest::eq(ring.capacity() % 4096, size_t { 0 });
+    qtest::is_true(ring.empty());
+    qtest::eq(ring.writable().size(), ring.capacity());
+
+    // Move the positions near the end
+    const auto cap = ring.capacity();
+    ring.commit(cap - 3);
+    ring.consume(cap - 3);
+    qtest::is_true(ring.empty());
+
+    // The write wraps the end but is contiguous
+    const auto data = strv_to_bin("abcdefgh");
+    auto w = ring.writable();
+    qtest::eq(w.size(), cap);
+    copy(data.begin(), data.end(), w.begin());
+    ring.commit(data.size());
+    qtest::eq(bin_to_strv(ring.readable()), "abcdefgh");
+
+    ring.consume(5);
+    qtest::eq(bin_to_strv(ring.readable()), "fgh");
+    qtest::eq(ring.size(), size_t { 3 });
+
+    try {
+      ring.consume(4);
+      qtest::unreachable();
+    } catch (const nes_exc&) {
+      qtest::ok("ring.consume(4); nes_exc ok");
+    }
+
+    ring.commit(cap - 3);
+    qtest::is_true(ring.full());
+    qtest::eq(ring.writable().size(), size_t { 0 });
+    ring.clear();
+    qtest::is_true(ring.empty());
+
+    qtest::sub_package_title("receive_into");
+
+    random_device rd;
+    mt19937 gen(rd());
+    uniform_int_distribution<unsigned> port_distrib(52233, 52732);
+    unsigned port_ran { port_distrib(gen) };
+
+    socket_serv serv { port_ran };
+    socket cli { "127.0.0.1", port_ran };
+    this_thread::sleep_for(50ms);
+    auto acc = serv.accept();
+    qtest::is_true(acc.has_value());
+
+    if (acc)
+    {
+      ring.commit(cap - 2);
+      ring.consume(cap - 2);
+
+      cli.send("line 1\nline 2\n");
+      acc->wait_readable(1s);
+      while (ring.size() < 14)
+        if (!receive_into(*acc, ring))
+          acc->wait_readable(100ms);
+
+      // Parse across the wrap point
+      const auto nl = bin_find(ring.readable(), strv_to_bin("\n"));
+      qtest::eq(bin_to_strv(ring.readable().first(nl)), "line 1");
+      ring.consume(nl + 1);
+      qtest::eq(bin_to_strv(ring.readable()), "line 2\n");
+    }
 }
+#endif